@@ -0,0 +1,73 @@
+// Measures how long parsing takes and how many allocations it makes. Parses the file given as the
+// only argument, or a generated source of about 5MB of loop statements otherwise, and reports the
+// best of seven parses.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+
+#include <lexer.h>
+#include <parser.h>
+#include <source.h>
+
+namespace {
+std::size_t allocations = 0;
+
+std::string generate_source() {
+    std::mt19937 random(1);
+    std::string source = "var acc = 0;\nvar arr = [1, 2, 3];\n";
+    for (int i = 0; i < 60000; ++i) {
+        source += "while (0) { acc = acc + (" + std::to_string(random() % 51) + " * 2 - arr[" +
+                  std::to_string(random() % 3) + "]) / 1; var b = [acc, " + std::to_string(random() % 100) +
+                  ", 3]; acc = acc - 1; }\n";
+    }
+    return source;
+}
+} // namespace
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (auto* p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+    std::string generated;
+    std::shared_ptr<rover::source_buffer const> source;
+    if (argc > 1) {
+        source = rover::source_buffer::map(argv[1]);
+        if (!source) {
+            std::fprintf(stderr, "Cannot open %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        generated = generate_source();
+        source = rover::source_buffer::borrow(generated);
+    }
+
+    double best = 0;
+    std::size_t count = 0;
+    for (int i = 0; i < 7; ++i) {
+        allocations = 0;
+        auto start = std::chrono::steady_clock::now();
+        rover::parser parser{rover::lexer(source)};
+        auto program = parser.parse();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        count = allocations;
+        if (i == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+
+    std::printf("%zu bytes: best %.1f ms, %.1f MB/s, %zu allocations\n", source->text().size(), best * 1e3,
+                source->text().size() / best / 1e6, count);
+    return 0;
+}
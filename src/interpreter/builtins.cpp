@@ -0,0 +1,522 @@
+#include "builtins.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+
+#include "format.h"
+#include "kernels.h"
+#include "operations.h"
+#include "thread_pool.h"
+
+namespace rover {
+value builtin_printf(value const* args, std::size_t count) {
+    if (count == 0) {
+        report_error("Function printf requires at least one argument");
+        return value();
+    }
+
+    if (!args[0].is_string()) {
+        report_error("Function printf requires a format string as its first argument");
+        return value();
+    }
+    return print_format(compile_format(args[0].as_string()), args + 1, count - 1);
+}
+
+value builtin_length(value const& array) {
+    if (!array.is_array()) {
+        report_error("Function length requires an array as its argument");
+        return value();
+    }
+
+    return {static_cast<int>(array.as_array().size())};
+}
+
+value builtin_push(value* target, value element) {
+    if (!target || !target->is_array()) {
+        report_error("Function push requires an array as its first argument");
+        return value();
+    }
+
+    target->mutable_array().push(std::move(element));
+    return *target;
+}
+
+value builtin_pop(value* target) {
+    if (!target || !target->is_array()) {
+        report_error("Function pop requires an array as its first argument");
+        return value();
+    }
+
+    auto& array = target->mutable_array();
+    if (array.size() == 0) {
+        return value();
+    }
+    return array.pop();
+}
+
+namespace {
+enum class numbers { ints, doubles, neither };
+
+// What a whole-array builtin can compute over an array. Packed arrays say it by their storage, arrays
+// of general values only if all their elements are ints or all are doubles.
+numbers numbers_in(array const& a) {
+    switch (a.kind()) {
+    case array::storage::bytes:
+        return numbers::ints;
+    case array::storage::doubles:
+        return numbers::doubles;
+    default:
+        break;
+    }
+
+    auto const& values = a.values();
+    if (std::all_of(values.begin(), values.end(), [](value const& v) { return v.is_int(); })) {
+        return numbers::ints;
+    } else if (std::all_of(values.begin(), values.end(), [](value const& v) { return v.is_double(); })) {
+        return numbers::doubles;
+    }
+    return numbers::neither;
+}
+
+// The doubles of an array holding only doubles, copied into `copy` unless they are stored packed.
+std::vector<double> const& doubles_of(array const& a, std::vector<double>& copy) {
+    if (a.kind() == array::storage::doubles) {
+        return a.doubles();
+    }
+
+    for (auto const& v : a.values()) {
+        copy.push_back(v.as_double());
+    }
+    return copy;
+}
+
+value wrapped(std::int64_t v) { return static_cast<int>((v % 100 + 100) % 100); }
+
+// The array argument of a whole-array builtin holding ints or doubles, or null after reporting why not.
+array const* numeric_argument(value const& v, std::string const& function) {
+    if (!v.is_array()) {
+        report_error("Function " + function + " requires an array as its argument");
+        return nullptr;
+    }
+    if (numbers_in(v.as_array()) == numbers::neither) {
+        report_error("Function " + function + " requires an array of integers or an array of doubles");
+        return nullptr;
+    }
+    return &v.as_array();
+}
+
+// The minimum, or the maximum unless `lowest`, of the elements of an array.
+value extreme(value const& v, std::string const& function, bool lowest) {
+    auto const* a = numeric_argument(v, function);
+    if (!a) {
+        return value();
+    }
+    if (a->size() == 0) {
+        report_error("Function " + function + " requires a non-empty array");
+        return value();
+    }
+
+    if (a->kind() == array::storage::bytes) {
+        auto const& bytes = a->bytes();
+        return lowest ? kernels::min(bytes.data(), bytes.size()) : kernels::max(bytes.data(), bytes.size());
+    } else if (numbers_in(*a) == numbers::doubles) {
+        std::vector<double> copy;
+        auto const& doubles = doubles_of(*a, copy);
+        return lowest ? kernels::min(doubles.data(), doubles.size()) : kernels::max(doubles.data(), doubles.size());
+    }
+
+    auto const& values = a->values();
+    auto by_int = [](value const& l, value const& r) { return l.as_int() < r.as_int(); };
+    return lowest ? *std::min_element(values.begin(), values.end(), by_int)
+                  : *std::max_element(values.begin(), values.end(), by_int);
+}
+
+constexpr std::size_t chunk_size = 1 << 16;
+
+std::size_t chunks_of(std::size_t n) { return (n + chunk_size - 1) / chunk_size; }
+
+// Calls `job` with the number and the bounds of every chunk of an array of `n` elements on the pool.
+template <typename Job>
+void for_each_chunk(std::size_t n, Job job) {
+    pool().run(chunks_of(n), [&](std::size_t chunk) {
+        auto begin = chunk * chunk_size;
+        job(chunk, begin, std::min(begin + chunk_size, n));
+    });
+}
+
+// Orders NaNs after every other double, so that sorting is defined for any of them.
+bool sorts_before(double l, double r) { return l < r || (std::isnan(r) && !std::isnan(l)); }
+
+// Sorts the chunks of `v`, then merges pairs of sorted runs until one is left.
+template <typename T, typename Less>
+void parallel_sort(std::vector<T>& v, Less less) {
+    for_each_chunk(v.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::sort(v.begin() + begin, v.begin() + end, less);
+    });
+
+    std::vector<T> merged(v.size());
+    for (std::size_t width = chunk_size; width < v.size(); width *= 2) {
+        pool().run((v.size() + 2 * width - 1) / (2 * width), [&](std::size_t pair) {
+            auto begin = v.begin() + pair * 2 * width;
+            auto middle = v.begin() + std::min(pair * 2 * width + width, v.size());
+            auto end = v.begin() + std::min(pair * 2 * width + 2 * width, v.size());
+            std::merge(begin, middle, middle, end, merged.begin() + (begin - v.begin()), less);
+        });
+        v.swap(merged);
+    }
+}
+
+enum class operation { scale, offset, clamp };
+
+std::int64_t apply(operation op, std::int64_t x, value const* operands) {
+    switch (op) {
+    case operation::scale:
+        return wrapped(x % 100 * (operands[0].as_int() % 100)).as_int();
+    case operation::offset:
+        return wrapped(x + operands[0].as_int()).as_int();
+    default:
+        return x < operands[0].as_int() ? operands[0].as_int() : x > operands[1].as_int() ? operands[1].as_int() : x;
+    }
+}
+
+void apply(operation op, double* v, std::size_t n, value const* operands) {
+    auto first = operands[0].as_double();
+    switch (op) {
+    case operation::scale:
+        kernels::scale(v, n, first);
+        break;
+    case operation::offset:
+        for (std::size_t i = 0; i < n; ++i) {
+            v[i] += first;
+        }
+        break;
+    case operation::clamp: {
+        auto last = operands[1].as_double();
+        for (std::size_t i = 0; i < n; ++i) {
+            v[i] = v[i] < first ? first : v[i] > last ? last : v[i];
+        }
+        break;
+    }
+    }
+}
+} // namespace
+
+value builtin_sum(value const& v) {
+    auto const* a = numeric_argument(v, "sum");
+    if (!a) {
+        return value();
+    }
+
+    if (a->kind() == array::storage::bytes) {
+        return wrapped(static_cast<std::int64_t>(kernels::sum(a->bytes().data(), a->size())));
+    } else if (numbers_in(*a) == numbers::doubles) {
+        std::vector<double> copy;
+        auto const& doubles = doubles_of(*a, copy);
+        return kernels::sum(doubles.data(), doubles.size());
+    }
+
+    std::int64_t total = 0;
+    for (auto const& element : a->values()) {
+        total += element.as_int() % 100;
+    }
+    return wrapped(total);
+}
+
+value builtin_min(value const& array) { return extreme(array, "min", true); }
+
+value builtin_max(value const& array) { return extreme(array, "max", false); }
+
+value builtin_dot(value const& left, value const& right) {
+    if (!left.is_array() || !right.is_array()) {
+        report_error("Function dot requires two arrays as its arguments");
+        return value();
+    }
+
+    auto const& l = left.as_array();
+    auto const& r = right.as_array();
+    auto kind = numbers_in(l);
+    if (kind == numbers::neither || kind != numbers_in(r)) {
+        report_error("Function dot requires two arrays of integers or two arrays of doubles");
+        return value();
+    }
+    if (l.size() != r.size()) {
+        report_error("Function dot requires arrays of the same length");
+        return value();
+    }
+
+    if (l.kind() == array::storage::bytes && r.kind() == array::storage::bytes) {
+        return wrapped(static_cast<std::int64_t>(kernels::dot(l.bytes().data(), r.bytes().data(), l.size())));
+    } else if (kind == numbers::doubles) {
+        std::vector<double> left_copy;
+        std::vector<double> right_copy;
+        return kernels::dot(doubles_of(l, left_copy).data(), doubles_of(r, right_copy).data(), l.size());
+    }
+
+    std::int64_t total = 0;
+    for (std::size_t i = 0; i < l.size(); ++i) {
+        total += static_cast<std::int64_t>(l[i].as_int() % 100) * (r[i].as_int() % 100);
+    }
+    return wrapped(total);
+}
+
+value builtin_fill(value* target, value const& element) {
+    if (!target || !target->is_array()) {
+        report_error("Function fill requires an array as its first argument");
+        return value();
+    }
+
+    target->mutable_array().fill(element);
+    return *target;
+}
+
+value builtin_scale(value* target, value const& factor) {
+    if (!target || !target->is_array()) {
+        report_error("Function scale requires an array as its first argument");
+        return value();
+    }
+
+    auto kind = numbers_in(target->as_array());
+    if (target->as_array().size() != 0 && !(kind == numbers::ints && factor.is_int()) &&
+        !(kind == numbers::doubles && factor.is_double())) {
+        report_error("Function scale requires a factor of the same type as the elements of the array");
+        return value();
+    }
+
+    auto& a = target->mutable_array();
+    if (a.kind() == array::storage::bytes && factor.is_int()) {
+        // Every byte has one of 256 products, which are looked up instead of computed.
+        std::uint8_t products[256];
+        auto f = factor.as_int() % 100;
+        for (int i = 0; i < 256; ++i) {
+            products[i] = static_cast<std::uint8_t>(wrapped(static_cast<std::int64_t>(i) * f).as_int());
+        }
+        for (auto& element : a.bytes()) {
+            element = products[element];
+        }
+    } else if (a.kind() == array::storage::doubles && factor.is_double()) {
+        kernels::scale(a.doubles().data(), a.size(), factor.as_double());
+    } else if (kind == numbers::ints) {
+        // The products are bytes, so the array is stored packed again.
+        std::vector<value> products;
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            products.push_back(wrapped(static_cast<std::int64_t>(a[i].as_int() % 100) * (factor.as_int() % 100)));
+        }
+        a = array(std::move(products));
+    } else {
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            a.set(i, a[i].as_double() * factor.as_double());
+        }
+    }
+    return *target;
+}
+
+value builtin_parallel_sum(value const& v) {
+    auto const* a = numeric_argument(v, "parallel_sum");
+    if (!a) {
+        return value();
+    }
+
+    if (a->kind() == array::storage::bytes) {
+        std::vector<std::uint64_t> sums(chunks_of(a->size()));
+        auto const* bytes = a->bytes().data();
+        for_each_chunk(a->size(), [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            sums[chunk] = kernels::sum(bytes + begin, end - begin);
+        });
+        return wrapped(static_cast<std::int64_t>(std::accumulate(sums.begin(), sums.end(), std::uint64_t(0))));
+    } else if (numbers_in(*a) == numbers::doubles) {
+        std::vector<double> copy;
+        auto const* doubles = doubles_of(*a, copy).data();
+        std::vector<double> sums(chunks_of(a->size()));
+        for_each_chunk(a->size(), [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            sums[chunk] = kernels::sum(doubles + begin, end - begin);
+        });
+        // The sums of the chunks are added up in order.
+        return std::accumulate(sums.begin(), sums.end(), 0.0);
+    }
+
+    // Ints that do not fit into bytes are rare enough to be added up by the calling thread.
+    return builtin_sum(v);
+}
+
+value builtin_parallel_sort(value* target) {
+    if (!target) {
+        report_error("Function parallel_sort requires an array as its argument");
+        return value();
+    }
+    if (!numeric_argument(*target, "parallel_sort")) {
+        return value();
+    }
+
+    auto kind = numbers_in(target->as_array());
+    auto& a = target->mutable_array();
+    if (a.kind() == array::storage::bytes) {
+        // Bytes are counted in every chunk, and the array is rewritten from the counts.
+        auto& bytes = a.bytes();
+        std::vector<std::array<std::size_t, 256>> counts(chunks_of(bytes.size()));
+        for_each_chunk(bytes.size(), [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            counts[chunk].fill(0);
+            for (auto i = begin; i < end; ++i) {
+                ++counts[chunk][bytes[i]];
+            }
+        });
+
+        auto* out = bytes.data();
+        for (std::size_t b = 0; b < 256; ++b) {
+            std::size_t count = 0;
+            for (auto const& chunk : counts) {
+                count += chunk[b];
+            }
+            out = std::fill_n(out, count, static_cast<std::uint8_t>(b));
+        }
+    } else if (a.kind() == array::storage::doubles) {
+        parallel_sort(a.doubles(), sorts_before);
+    } else if (kind == numbers::ints) {
+        std::vector<int> ints;
+        for (auto const& element : a.values()) {
+            ints.push_back(element.as_int());
+        }
+        parallel_sort(ints, std::less<int>());
+        a = array(std::vector<value>(ints.begin(), ints.end()));
+    } else {
+        std::vector<double> doubles;
+        doubles_of(a, doubles);
+        parallel_sort(doubles, sorts_before);
+        a = array(std::vector<value>(doubles.begin(), doubles.end()));
+    }
+    return *target;
+}
+
+value builtin_parallel_apply(value* target, value const* args, std::size_t count) {
+    if (!target || !target->is_array()) {
+        report_error("Function parallel_apply requires an array as its first argument");
+        return value();
+    }
+
+    auto name = args[0].is_string() ? args[0].as_string() : std::string();
+    if (name != "scale" && name != "offset" && name != "clamp") {
+        report_error("Function parallel_apply requires \"scale\", \"offset\" or \"clamp\" as its second argument");
+        return value();
+    }
+    auto op = name == "scale" ? operation::scale : name == "offset" ? operation::offset : operation::clamp;
+    auto const* operands = args + 1;
+    auto operand_count = op == operation::clamp ? 2u : 1u;
+    if (count - 1 != operand_count) {
+        std::string operands_text = operand_count == 1 ? "one operand" : "two operands";
+        report_error("Function parallel_apply requires " + operands_text + " for " + name);
+        return value();
+    }
+
+    auto kind = numbers_in(target->as_array());
+    if (kind == numbers::neither) {
+        report_error("Function parallel_apply requires an array of integers or an array of doubles");
+        return value();
+    }
+    auto same_type = std::all_of(operands, operands + operand_count, [&](value const& v) {
+        return kind == numbers::ints ? v.is_int() : v.is_double();
+    });
+    if (target->as_array().size() == 0) {
+        return *target;
+    } else if (!same_type) {
+        report_error("Function parallel_apply requires operands of the same type as the elements of the array");
+        return value();
+    }
+
+    auto& a = target->mutable_array();
+    if (kind == numbers::doubles) {
+        auto packed = a.kind() == array::storage::doubles;
+        std::vector<double> copy;
+        if (!packed) {
+            doubles_of(a, copy);
+        }
+        auto* doubles = packed ? a.doubles().data() : copy.data();
+        for_each_chunk(a.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+            apply(op, doubles + begin, end - begin, operands);
+        });
+        if (!packed) {
+            a = array(std::vector<value>(copy.begin(), copy.end()));
+        }
+        return *target;
+    }
+
+    if (a.kind() == array::storage::bytes) {
+        // Every byte has one of 256 results, which are looked up instead of computed.
+        std::int64_t results[256];
+        for (int i = 0; i < 256; ++i) {
+            results[i] = apply(op, i, operands);
+        }
+        if (std::all_of(results, results + 256, [](std::int64_t r) { return r >= 0 && r <= 255; })) {
+            auto* bytes = a.bytes().data();
+            for_each_chunk(a.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+                for (auto i = begin; i < end; ++i) {
+                    bytes[i] = static_cast<std::uint8_t>(results[bytes[i]]);
+                }
+            });
+            return *target;
+        }
+    }
+
+    // Results that are not bytes turn the array into one of general values, built by the calling thread.
+    std::vector<value> results;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        results.push_back(static_cast<int>(apply(op, a[i].as_int(), operands)));
+    }
+    a = array(std::move(results));
+    return *target;
+}
+
+builtin_registry::builtin_registry() {
+    add({"printf", 1, true, false, false,
+         [](value*, value const* args, std::size_t count) { return builtin_printf(args, count); }});
+    add({"length", 1, false, false, true,
+         [](value*, value const* args, std::size_t) { return builtin_length(args[0]); }});
+    add({"push", 2, false, true, false,
+         [](value* target, value const* args, std::size_t) { return builtin_push(target, args[0]); }});
+    add({"pop", 1, false, true, false,
+         [](value* target, value const*, std::size_t) { return builtin_pop(target); }});
+    add({"sum", 1, false, false, true,
+         [](value*, value const* args, std::size_t) { return builtin_sum(args[0]); }});
+    add({"min", 1, false, false, true,
+         [](value*, value const* args, std::size_t) { return builtin_min(args[0]); }});
+    add({"max", 1, false, false, true,
+         [](value*, value const* args, std::size_t) { return builtin_max(args[0]); }});
+    add({"fill", 2, false, true, false,
+         [](value* target, value const* args, std::size_t) { return builtin_fill(target, args[0]); }});
+    add({"scale", 2, false, true, false,
+         [](value* target, value const* args, std::size_t) { return builtin_scale(target, args[0]); }});
+    add({"dot", 2, false, false, true,
+         [](value*, value const* args, std::size_t) { return builtin_dot(args[0], args[1]); }});
+    add({"parallel_sum", 1, false, false, true,
+         [](value*, value const* args, std::size_t) { return builtin_parallel_sum(args[0]); }});
+    add({"parallel_sort", 1, false, true, false,
+         [](value* target, value const*, std::size_t) { return builtin_parallel_sort(target); }});
+    add({"parallel_apply", 3, true, true, false, builtin_parallel_apply});
+}
+
+std::size_t builtin_registry::add(builtin b) {
+    auto id = builtins.size();
+    ids[symbols().intern(b.name)] = id;
+    builtins.push_back(std::move(b));
+    return id;
+}
+
+std::size_t builtin_registry::add(std::string name, std::size_t arity, native_function function) {
+    return add({std::move(name), arity, false, false, false, function});
+}
+
+std::optional<std::size_t> builtin_registry::find(symbol name) const {
+    auto it = ids.find(name);
+    if (it == ids.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+builtin_registry& builtins() {
+    static builtin_registry registry;
+    return registry;
+}
+} // namespace rover
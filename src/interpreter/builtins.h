@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <symbol.h>
+
+#include "value.h"
+
+namespace rover {
+value builtin_printf(value const* args, std::size_t count);
+value builtin_length(value const& array);
+value builtin_push(value* target, value element);
+value builtin_pop(value* target);
+// Whole-array builtins, which run over the packed storage of arrays of ints or of doubles with the
+// vectorized kernels. Int results wrap like the result of any other int operation.
+value builtin_sum(value const& array);
+value builtin_min(value const& array);
+value builtin_max(value const& array);
+value builtin_dot(value const& left, value const& right);
+value builtin_fill(value* target, value const& element);
+value builtin_scale(value* target, value const& factor);
+// Builtins splitting arrays into chunks of a fixed size that run on the thread pool. The chunks do
+// not depend on the number of threads, and neither do the results.
+value builtin_parallel_sum(value const& array);
+value builtin_parallel_sort(value* target);
+// Applies "scale", "offset" or "clamp" (given the operation's operands) to every element.
+value builtin_parallel_apply(value* target, value const* args, std::size_t count);
+
+// A native function called with the values of the call's arguments. Builtins taking a reference
+// get the variable or array element named by their first argument as `target` (null if there is
+// no such variable) and only the remaining arguments in `args`. Others get a null `target`.
+using native_function = value (*)(value* target, value const* args, std::size_t count);
+
+struct builtin {
+    std::string name;
+    std::size_t arity;
+    bool variadic;     // also accepts more than `arity` arguments
+    bool by_reference; // the first argument is passed as `target`
+    bool pure;         // only computes its result, so calls with equal arguments can share it
+    native_function function;
+};
+
+// Builtins every registry starts out with, in the order of their ids.
+enum builtin_id : std::size_t {
+    printf_builtin,
+    length_builtin,
+    push_builtin,
+    pop_builtin,
+    sum_builtin,
+    min_builtin,
+    max_builtin,
+    fill_builtin,
+    scale_builtin,
+    dot_builtin,
+    parallel_sum_builtin,
+    parallel_sort_builtin,
+    parallel_apply_builtin,
+};
+
+// The functions callable from rover programs. The resolver binds every call to the id of its
+// builtin, so that calling one is an index into the registry rather than a lookup by name.
+class builtin_registry {
+private:
+    std::vector<builtin> builtins;
+    std::unordered_map<symbol, std::size_t> ids;
+
+    std::size_t add(builtin b);
+
+public:
+    builtin_registry();
+
+    // Registers a native function taking `arity` arguments by value and returns its id. It can be
+    // called by programs resolved after it was registered, and is assumed to have side effects.
+    std::size_t add(std::string name, std::size_t arity, native_function function);
+
+    std::optional<std::size_t> find(symbol name) const;
+    builtin const& operator[](std::size_t id) const { return builtins[id]; }
+};
+
+// The registry used by the resolver and both engines.
+builtin_registry& builtins();
+} // namespace rover
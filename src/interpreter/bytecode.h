@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "format.h"
+#include "value.h"
+
+namespace rover {
+enum class opcode : std::uint8_t {
+    CONSTANT,      // push constants[a]
+    POP,           // discard the top of the stack
+    LOAD,          // push a copy of slots[a]
+    DEFINE,        // pop into slots[a]
+    STORE,         // assign the top of the stack to slots[a], leaving the assigned value
+    LOAD_ELEMENT,  // pop index and array, push the element
+    STORE_ELEMENT, // pop b indices, assign the value below them to the element of slots[a]
+    BINARY,        // pop two operands, push the result of the operator token_type(a), quickened as quick_op(b)
+    UNARY,         // pop one operand, push the result of the operator token_type(a), quickened as quick_op(b)
+    ARRAY,         // pop a elements, push an array holding them
+    JUMP,          // continue at a
+    JUMP_IF_FALSE, // pop, continue at a if the value is not truthy
+    PRINTF,        // pop a arguments, print them, push the result
+    FORMAT,        // pop a arguments, print them with formats[b], push the result
+    LENGTH,        // pop an array, push its length
+    PUSH,          // pop an element and b indices, append the element to the array in slots[a]
+    POP_BACK,      // pop b indices, remove the last element of the array in slots[a] and push it
+    CALL,          // pop b arguments, push the result of calling the builtin with id a
+    CALL_TARGET,   // pop the arguments and indices of targeted_calls[a], push the result of the call
+    CLEAR,         // empty the b slots starting at slots[a] when their block exits
+    CACHED,        // if cache a holds a value, push it and continue at b
+    CACHE,         // store the top of the stack in cache a
+    ENTER_LOOP,    // begin a new entry into loop a, invalidating the caches of the last one
+    ITERATE,       // begin a new iteration of loop a
+};
+
+struct instruction {
+    opcode op;
+    std::int32_t a;
+    std::int32_t b;
+};
+
+// A slot operand that does not refer to any variable. Instructions reading or
+// writing it report the same errors the tree-walking interpreter does.
+constexpr std::int32_t no_slot = -1;
+
+// A call to a builtin taking its first argument by reference, which names the element at `indices`
+// indices into slots[slot], in the order they apply. The indices are pushed before the remaining `arguments` arguments.
+struct targeted_call {
+    std::size_t function;
+    std::int32_t slot;
+    std::int32_t indices;
+    std::int32_t arguments;
+};
+
+struct chunk {
+    std::vector<instruction> code;
+    std::vector<value> constants;
+    std::vector<format_string> formats;
+    std::vector<targeted_call> targeted_calls;
+    std::size_t slot_count = 0;
+    // The scope of every cache, and the number of loops owning caches, as in the program.
+    std::vector<std::size_t> cache_scopes;
+    std::size_t loop_count = 0;
+};
+} // namespace rover
@@ -0,0 +1,226 @@
+#include "compiler.h"
+
+#include <algorithm>
+
+#include "builtins.h"
+#include "runtime.h"
+
+namespace rover {
+compiler::compiler() {}
+compiler::~compiler() {}
+
+chunk compiler::compile(program const& p, std::size_t globals) {
+    chunk_ = {};
+    for (auto const& c : p.constants) {
+        add_constant(to_value(c));
+    }
+    chunk_.cache_scopes = p.cache_scopes;
+    chunk_.loop_count = p.loop_count;
+
+    frames.clear();
+    enter_frame(0, globals);
+
+    for (auto const& stmt : p.statements) {
+        stmt->accept(*this);
+    }
+
+    return std::move(chunk_);
+}
+
+std::size_t compiler::emit(opcode op, std::int32_t a, std::int32_t b) {
+    chunk_.code.push_back({op, a, b});
+    return chunk_.code.size() - 1;
+}
+
+std::int32_t compiler::add_constant(value v) {
+    chunk_.constants.push_back(std::move(v));
+    return static_cast<std::int32_t>(chunk_.constants.size() - 1);
+}
+
+void compiler::patch_jump(std::size_t at) { chunk_.code[at].a = static_cast<std::int32_t>(chunk_.code.size()); }
+
+void compiler::enter_frame(std::int32_t base, std::size_t size) {
+    frames.push_back({base, size});
+    chunk_.slot_count = std::max(chunk_.slot_count, base + size);
+}
+
+std::int32_t compiler::slot_of(identifier_expression const& node) const {
+    return frames[frames.size() - 1 - node.depth].base + static_cast<std::int32_t>(node.slot);
+}
+
+std::int32_t compiler::lvalue(expression const& node, std::int32_t& indices) {
+    if (auto* e = node.as<identifier_expression>()) {
+        return slot_of(*e);
+    } else if (auto* e = node.as<array_ref_expression>()) {
+        auto slot = lvalue(*e->array, indices);
+        e->index->accept(*this);
+        ++indices;
+        return slot;
+    } else {
+        return no_slot;
+    }
+}
+
+void compiler::visit(binary_op_expression const& node) {
+    if (node.op.type == token_type::ASSIGN) {
+        node.right->accept(*this);
+
+        std::int32_t indices = 0;
+        auto slot = lvalue(*node.left, indices);
+        if (indices == 0) {
+            emit(opcode::STORE, slot);
+        } else {
+            emit(opcode::STORE_ELEMENT, slot, indices);
+        }
+        return;
+    }
+
+    node.left->accept(*this);
+    node.right->accept(*this);
+    emit(opcode::BINARY, static_cast<std::int32_t>(node.op.type), node.quickened);
+}
+
+void compiler::visit(unary_op_expression const& node) {
+    node.right->accept(*this);
+    emit(opcode::UNARY, static_cast<std::int32_t>(node.op.type), node.quickened);
+}
+
+void compiler::visit(literal_expression const& node) {
+    emit(opcode::CONSTANT, static_cast<std::int32_t>(node.constant));
+}
+
+void compiler::visit(identifier_expression const& node) { emit(opcode::LOAD, slot_of(node)); }
+
+void compiler::visit(function_call_expression const& node) {
+    auto argc = static_cast<std::int32_t>(node.arguments.size());
+    std::int32_t indices = 0;
+
+    switch (node.function) {
+    case printf_builtin: {
+        auto format = node.arguments.front()->as<literal_expression>();
+        if (format && format->literal.type == token_type::STRING) {
+            for (auto it = node.arguments.begin() + 1; it != node.arguments.end(); ++it) {
+                (*it)->accept(*this);
+            }
+            chunk_.formats.push_back(compile_format(chunk_.constants[format->constant].as_string()));
+            emit(opcode::FORMAT, argc - 1, static_cast<std::int32_t>(chunk_.formats.size() - 1));
+            return;
+        }
+
+        for (auto const& arg : node.arguments) {
+            arg->accept(*this);
+        }
+        emit(opcode::PRINTF, argc);
+        break;
+    }
+    case length_builtin:
+        node.arguments.front()->accept(*this);
+        emit(opcode::LENGTH);
+        break;
+    // push and pop have instructions of their own, which skip looking up a targeted_call.
+    case push_builtin: {
+        auto slot = lvalue(*node.arguments.front(), indices);
+        node.arguments.back()->accept(*this);
+        emit(opcode::PUSH, slot, indices);
+        break;
+    }
+    case pop_builtin: {
+        auto slot = lvalue(*node.arguments.front(), indices);
+        emit(opcode::POP_BACK, slot, indices);
+        break;
+    }
+    default:
+        if (builtins()[node.function].by_reference) {
+            auto slot = lvalue(*node.arguments.front(), indices);
+            for (auto it = node.arguments.begin() + 1; it != node.arguments.end(); ++it) {
+                (*it)->accept(*this);
+            }
+            chunk_.targeted_calls.push_back({node.function, slot, indices, argc - 1});
+            emit(opcode::CALL_TARGET, static_cast<std::int32_t>(chunk_.targeted_calls.size() - 1));
+            break;
+        }
+
+        for (auto const& arg : node.arguments) {
+            arg->accept(*this);
+        }
+        emit(opcode::CALL, static_cast<std::int32_t>(node.function), argc);
+        break;
+    }
+}
+
+void compiler::visit(array_literal_expression const& node) {
+    for (auto const& element : node.elements) {
+        element->accept(*this);
+    }
+    emit(opcode::ARRAY, static_cast<std::int32_t>(node.elements.size()));
+}
+
+void compiler::visit(array_ref_expression const& node) {
+    node.array->accept(*this);
+    node.index->accept(*this);
+    emit(opcode::LOAD_ELEMENT);
+}
+
+void compiler::visit(cached_expression const& node) {
+    auto cached = emit(opcode::CACHED, static_cast<std::int32_t>(node.cache));
+    node.inner->accept(*this);
+    emit(opcode::CACHE, static_cast<std::int32_t>(node.cache));
+    chunk_.code[cached].b = static_cast<std::int32_t>(chunk_.code.size());
+}
+
+void compiler::visit(expression_statement const& node) {
+    node.expr->accept(*this);
+    emit(opcode::POP);
+}
+
+void compiler::visit(block_statement const& node) {
+    auto const& current = frames.back();
+    enter_frame(current.base + static_cast<std::int32_t>(current.size), node.frame_size);
+    for (auto const& stmt : node.statements) {
+        stmt->accept(*this);
+    }
+    if (node.frame_size) {
+        // Like the interpreter's frames, the block's variables do not outlive it.
+        emit(opcode::CLEAR, frames.back().base, static_cast<std::int32_t>(node.frame_size));
+    }
+    frames.pop_back();
+}
+
+void compiler::visit(definition_statement const& node) {
+    node.initializer->accept(*this);
+    emit(opcode::DEFINE, frames.back().base + static_cast<std::int32_t>(node.slot));
+}
+
+void compiler::visit(conditional_statement const& node) {
+    node.condition->accept(*this);
+    auto to_else = emit(opcode::JUMP_IF_FALSE);
+
+    node.then_branch->accept(*this);
+
+    if (node.else_branch) {
+        auto to_end = emit(opcode::JUMP);
+        patch_jump(to_else);
+        node.else_branch->accept(*this);
+        patch_jump(to_end);
+    } else {
+        patch_jump(to_else);
+    }
+}
+
+void compiler::visit(while_statement const& node) {
+    if (node.loop != no_loop) {
+        emit(opcode::ENTER_LOOP, static_cast<std::int32_t>(node.loop));
+    }
+
+    auto start = static_cast<std::int32_t>(chunk_.code.size());
+    if (node.loop != no_loop) {
+        emit(opcode::ITERATE, static_cast<std::int32_t>(node.loop));
+    }
+    node.condition->accept(*this);
+    auto to_end = emit(opcode::JUMP_IF_FALSE);
+
+    node.body->accept(*this);
+    emit(opcode::JUMP, start);
+    patch_jump(to_end);
+}
+} // namespace rover
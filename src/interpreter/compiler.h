@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <ast.h>
+
+#include "bytecode.h"
+
+namespace rover {
+class compiler : public expression_visitor, public statement_visitor {
+private:
+    struct frame {
+        std::int32_t base;
+        std::size_t size;
+    };
+
+    chunk chunk_;
+    std::vector<frame> frames;
+
+    std::size_t emit(opcode op, std::int32_t a = 0, std::int32_t b = 0);
+    std::int32_t add_constant(value v);
+    void patch_jump(std::size_t at);
+
+    void enter_frame(std::int32_t base, std::size_t size);
+    std::int32_t slot_of(identifier_expression const& node) const;
+    std::int32_t lvalue(expression const& node, std::int32_t& indices);
+
+public:
+    compiler();
+    virtual ~compiler();
+
+    // Compiles a resolved program whose global frame holds `globals` variables.
+    chunk compile(program const& p, std::size_t globals);
+
+    void visit(binary_op_expression const& node) override;
+    void visit(unary_op_expression const& node) override;
+    void visit(literal_expression const& node) override;
+    void visit(identifier_expression const& node) override;
+    void visit(function_call_expression const& node) override;
+    void visit(array_literal_expression const& node) override;
+    void visit(array_ref_expression const& node) override;
+    void visit(cached_expression const& node) override;
+
+    void visit(expression_statement const& node) override;
+    void visit(block_statement const& node) override;
+    void visit(definition_statement const& node) override;
+    void visit(conditional_statement const& node) override;
+    void visit(while_statement const& node) override;
+};
+} // namespace rover
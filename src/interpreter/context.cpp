@@ -1,44 +1,36 @@
 #include <context.h>
 
 namespace rover {
-context::context(context* parent_) : parent(parent_) {}
-
-void context::set(std::string const& name, value const& v) { variables[name] = v; }
-
-bool context::update(std::string const& name, value const& v) {
-    auto it = variables.find(name);
-    if (it == variables.end()) {
-        if (parent) {
-            return parent->update(name, v);
-        } else {
-            return false;
-        }
-    }
+context::context(context* parent_, std::size_t size) : slots(size, value()), parent(parent_) {}
 
-    if (it->second.is_const) {
-        return false;
+value& context::at(std::size_t depth, std::size_t slot) {
+    auto* frame = this;
+    while (depth--) {
+        frame = frame->parent;
     }
-
-    it->second = v;
-    return true;
+    return frame->slots[slot];
 }
 
-std::optional<value> context::get(std::string const& name) {
-    if (auto ptr = get_ptr(name)) {
-        return *ptr;
-    } else {
-        return std::nullopt;
-    }
+void context::reset(context* parent_, std::size_t size) {
+    parent = parent_;
+    slots.resize(size, value());
 }
 
-value* context::get_ptr(std::string const& name) {
-    auto it = variables.find(name);
-    if (it != variables.end()) {
-        return &(it->second);
-    } else if (parent) {
-        return parent->get_ptr(name);
+void context::clear() { slots.clear(); }
+
+context* frame_pool::acquire(context* parent, std::size_t size) {
+    if (used == frames.size()) {
+        frames.push_back(std::make_unique<context>(parent, size));
     } else {
-        return nullptr;
+        frames[used]->reset(parent, size);
     }
+    return frames[used++].get();
 }
-} // namespace rover
\ No newline at end of file
+
+void frame_pool::release() { frames[--used]->clear(); }
+
+scoped_frame::scoped_frame(frame_pool& pool_, context* parent, std::size_t size)
+    : pool(pool_), frame(pool.acquire(parent, size)) {}
+
+scoped_frame::~scoped_frame() { pool.release(); }
+} // namespace rover
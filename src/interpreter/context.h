@@ -1,24 +1,53 @@
 #pragma once
 
-#include <optional>
-#include <string>
-
-#include <unordered_map>
+#include <cstddef>
+#include <memory>
+#include <vector>
 
 #include "value.h"
 
 namespace rover {
 class context {
 private:
-    std::unordered_map<std::string, value> variables;
+    std::vector<value> slots;
     context* parent;
 
 public:
-    context(context* parent_);
+    context(context* parent_, std::size_t size);
+
+    value& at(std::size_t depth, std::size_t slot);
+
+    // Re-initializes the frame for another block, keeping the storage of its slots.
+    void reset(context* parent_, std::size_t size);
+    // Drops the values held by the frame, so that nothing is kept alive by an unused frame.
+    void clear();
+};
+
+// Frames for block scopes. Blocks are exited in the reverse order they were entered in, so frames
+// are handed out and returned like a stack and the same few frames are reused by every block
+// entered at the same nesting level.
+class frame_pool {
+private:
+    std::vector<std::unique_ptr<context>> frames;
+    std::size_t used = 0;
+
+public:
+    context* acquire(context* parent, std::size_t size);
+    void release();
+};
+
+// Holds a frame from a pool for the lifetime of a block.
+class scoped_frame {
+private:
+    frame_pool& pool;
+    context* frame;
+
+public:
+    scoped_frame(frame_pool& pool_, context* parent, std::size_t size);
+    ~scoped_frame();
+    scoped_frame(scoped_frame const&) = delete;
+    scoped_frame& operator=(scoped_frame const&) = delete;
 
-    void set(std::string const& name, value const& v);
-    bool update(std::string const& name, value const& v);
-    std::optional<value> get(std::string const& name);
-    value* get_ptr(std::string const& name);
+    context* get() const { return frame; }
 };
-} // namespace rover
\ No newline at end of file
+} // namespace rover
@@ -0,0 +1,234 @@
+#include "flat_interpreter.h"
+
+#include "builtins.h"
+#include "format.h"
+#include "operations.h"
+
+namespace rover {
+flat_interpreter::flat_interpreter(flat_ast const& ast_, runtime& rt_, context* ctx_)
+    : ast(ast_), rt(rt_), ctx(ctx_), quickened(ast_.expression_kinds.size(), quick_op::generic) {
+    // Operators whose operand types the type checker knows start out specialized for them.
+    auto const& t = ast.expressions;
+    auto const& types = ast.expression_types;
+    for (node_index e = 0; e < quickened.size(); ++e) {
+        auto op = static_cast<token_type>(t.c[e]);
+        if (ast.expression_kinds[e] == expression_kind::binary_op && op != token_type::ASSIGN) {
+            quickened[e] = quicken(op, types[t.a[e]], types[t.b[e]]);
+        } else if (ast.expression_kinds[e] == expression_kind::unary_op) {
+            quickened[e] = quicken(op, types[t.a[e]]);
+        }
+    }
+}
+
+void flat_interpreter::run() {
+    for (node_index i = 0; i < ast.statement_count; ++i) {
+        execute(ast.lists[ast.first_statement + i]);
+    }
+}
+
+void flat_interpreter::execute(node_index s) {
+    auto const& t = ast.statements;
+    value temporary;
+
+    switch (ast.statement_kinds[s]) {
+    case statement_kind::expression:
+        evaluate(t.a[s], temporary);
+        break;
+    case statement_kind::block: {
+        scoped_frame frame(rt.frames, ctx, t.c[s]);
+        auto* parent = ctx;
+        ctx = frame.get();
+        for (node_index i = 0; i < t.b[s]; ++i) {
+            execute(ast.lists[t.a[s] + i]);
+        }
+        ctx = parent;
+        break;
+    }
+    case statement_kind::definition: {
+        auto initial = take(t.a[s]);
+        ctx->at(0, t.b[s]) = std::move(initial);
+        break;
+    }
+    case statement_kind::conditional:
+        if (is_truthy(evaluate(t.a[s], temporary))) {
+            execute(t.b[s]);
+        } else if (t.c[s] != no_node) {
+            execute(t.c[s]);
+        }
+        break;
+    case statement_kind::while_loop:
+        if (t.c[s] == no_node) {
+            while (is_truthy(evaluate(t.a[s], temporary))) {
+                execute(t.b[s]);
+            }
+            break;
+        }
+
+        rt.caches.enter_loop(t.c[s]);
+        while (rt.caches.next_iteration(t.c[s]), is_truthy(evaluate(t.a[s], temporary))) {
+            execute(t.b[s]);
+        }
+        break;
+    }
+}
+
+value flat_interpreter::take(node_index e) {
+    value temporary;
+    auto const& result = evaluate(e, temporary);
+    if (&result == &temporary) {
+        return temporary;
+    } else {
+        return result;
+    }
+}
+
+value const& flat_interpreter::evaluate(node_index e, value& temporary) {
+    auto const& t = ast.expressions;
+
+    switch (ast.expression_kinds[e]) {
+    case expression_kind::binary_op: {
+        auto op = static_cast<token_type>(t.c[e]);
+        if (op == token_type::ASSIGN) {
+            auto right = take(t.b[e]);
+            if (ast.expression_kinds[t.a[e]] == expression_kind::array_ref) {
+                auto target = t.a[e];
+                std::vector<value> indices;
+                auto* variable = path(t.a[target], indices);
+                auto index = take(t.b[target]);
+                auto* array = element_at(variable, indices.data(), indices.size());
+                temporary = assign_element(array, index, std::move(right));
+                wrap_integer(temporary);
+                return temporary;
+            }
+
+            auto* target = get(t.a[e]);
+            if (!assign(target, std::move(right))) {
+                temporary = value();
+            } else if (target->is_int()) {
+                temporary = *target;
+                wrap_integer(temporary);
+            } else {
+                return *target;
+            }
+            return temporary;
+        }
+
+        auto left = take(t.a[e]);
+        auto const& right = evaluate(t.b[e], temporary);
+        if (!quick_binary(quickened[e], left, right, temporary)) {
+            quickened[e] = quicken(op, left, right);
+            temporary = binary_operation(op, left, right);
+        }
+        return temporary;
+    }
+    case expression_kind::unary_op: {
+        auto op = static_cast<token_type>(t.c[e]);
+        auto const& operand = evaluate(t.a[e], temporary);
+        if (!quick_unary(quickened[e], operand, temporary)) {
+            quickened[e] = quicken(op, operand);
+            temporary = unary_operation(op, operand);
+        }
+        return temporary;
+    }
+    case expression_kind::literal:
+        return rt.constants[t.a[e]];
+    case expression_kind::identifier:
+        return ctx->at(t.a[e], t.b[e]);
+    case expression_kind::function_call:
+        return call(e, temporary);
+    case expression_kind::array_literal: {
+        std::vector<value> elements;
+        elements.reserve(t.b[e]);
+        for (node_index i = 0; i < t.b[e]; ++i) {
+            elements.push_back(take(ast.lists[t.a[e] + i]));
+        }
+        temporary = value(std::move(elements));
+        return temporary;
+    }
+    case expression_kind::array_ref:
+        return element(e, temporary);
+    case expression_kind::cached: {
+        if (auto const* cached = rt.caches.find(t.b[e])) {
+            return *cached;
+        }
+        auto const& result = evaluate(t.a[e], temporary);
+        rt.caches.store(t.b[e], result);
+        return result;
+    }
+    }
+    return temporary;
+}
+
+value* flat_interpreter::path(node_index e, std::vector<value>& indices) {
+    auto const& t = ast.expressions;
+
+    switch (ast.expression_kinds[e]) {
+    case expression_kind::identifier:
+        return &ctx->at(t.a[e], t.b[e]);
+    case expression_kind::array_ref: {
+        auto* variable = path(t.a[e], indices);
+        indices.push_back(take(t.b[e]));
+        return variable;
+    }
+    default:
+        return nullptr;
+    }
+}
+
+value* flat_interpreter::get(node_index e) {
+    std::vector<value> indices;
+    auto* variable = path(e, indices);
+    return element_at(variable, indices.data(), indices.size());
+}
+
+value const& flat_interpreter::element(node_index e, value& temporary) {
+    auto const& t = ast.expressions;
+    // The index may modify the array, so the element is read from a copy of the array as it was.
+    auto array = take(t.a[e]);
+
+    auto const& index = evaluate(t.b[e], temporary);
+    temporary = element_of(array, index);
+    return temporary;
+}
+
+value const& flat_interpreter::call(node_index e, value& temporary) {
+    auto const& t = ast.expressions;
+    auto arg = ast.lists.begin() + t.a[e];
+    auto const end = arg + t.b[e];
+
+    format_string const* format = nullptr;
+    if (t.c[e] == printf_builtin && ast.expression_kinds[*arg] == expression_kind::literal) {
+        // Literal formats were compiled when the program was loaded, others are compiled by the call.
+        auto constant = t.a[*arg];
+        if (rt.constants[constant].is_string()) {
+            format = &rt.formats[constant];
+            ++arg;
+        }
+    }
+
+    auto const& function = builtins()[t.c[e]];
+    // As in expression_evaluator, the element a target refers to is resolved after the other arguments.
+    std::vector<value> indices;
+    value* variable = function.by_reference ? path(*arg++, indices) : nullptr;
+
+    // A single argument is passed without copying it, unless it might alias the target. Several are
+    // collected first.
+    auto count = static_cast<std::size_t>(end - arg);
+    std::vector<value> collected;
+    value const* args = nullptr;
+    if (count == 1 && !function.by_reference) {
+        args = &evaluate(*arg, temporary);
+    } else if (count > 0) {
+        collected.reserve(count);
+        for (; arg != end; ++arg) {
+            collected.push_back(take(*arg));
+        }
+        args = collected.data();
+    }
+    value* target = function.by_reference ? element_at(variable, indices.data(), indices.size()) : nullptr;
+
+    auto result = format ? print_format(*format, args, count) : function.function(target, args, count);
+    temporary = std::move(result);
+    return temporary;
+}
+} // namespace rover
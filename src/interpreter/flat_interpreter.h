@@ -0,0 +1,43 @@
+#pragma once
+
+#include <flat_ast.h>
+
+#include "context.h"
+#include "operations.h"
+#include "runtime.h"
+#include "value.h"
+
+namespace rover {
+// Runs a flat_ast, walking it with a switch over the node kinds. Produces the same results as
+// statement_executor does for the tree the flat_ast was made from.
+class flat_interpreter {
+private:
+    flat_ast const& ast;
+    runtime& rt;
+    context* ctx;
+    // The specialization of every operator node, indexed like the expressions.
+    std::vector<quick_op> quickened;
+
+    // Evaluates an expression. The result is either `temporary`, which receives values computed
+    // by the expression, or storage that outlives the evaluation (a variable, a constant or a cached
+    // value), which is then borrowed rather than copied.
+    value const& evaluate(node_index e, value& temporary);
+    // Evaluates an expression into a value that stays valid while other expressions are evaluated.
+    value take(node_index e);
+    // Evaluates the indices of an assignment target and returns the variable they index into, like
+    // expression_evaluator::path().
+    value* path(node_index e, std::vector<value>& indices);
+    // Returns the variable or array element an assignment target refers to, null if there is none
+    // (see element_at()).
+    value* get(node_index e);
+
+    value const& call(node_index e, value& temporary);
+    value const& element(node_index e, value& temporary);
+
+public:
+    flat_interpreter(flat_ast const& ast_, runtime& rt_, context* ctx_);
+
+    void run();
+    void execute(node_index s);
+};
+} // namespace rover
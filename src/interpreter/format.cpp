@@ -0,0 +1,83 @@
+#include "format.h"
+
+#include "operations.h"
+#include "output.h"
+
+namespace rover {
+format_string compile_format(std::string_view format) {
+    format_string result{{std::string()}, std::nullopt};
+
+    for (auto it = format.begin(); it != format.end(); ++it) {
+        auto& piece = result.pieces.back();
+        if (*it == '\\') {
+            ++it;
+            if (it == format.end()) {
+                result.error = "Invalid format string";
+                break;
+            }
+            if (*it == '\\') {
+                piece += '\\';
+            } else if (*it == 'n') {
+                piece += '\n';
+            } else if (*it == 't') {
+                piece += '\t';
+            } else if (*it == 'r') {
+                piece += '\r';
+            } else if (*it == 'v') {
+                piece += '\v';
+            } else if (*it == 'b') {
+                piece += '\b';
+            } else if (*it == 'a') {
+                piece += '\a';
+            } else if (*it == 'f') {
+                piece += '\f';
+            } else if (*it == '0') {
+                piece += '\0';
+            } else {
+                result.error = "Unknown escape sequence in format string";
+                break;
+            }
+        } else if (*it == '{') {
+            ++it;
+            if (it == format.end() || *it != '}') {
+                result.error = "Invalid format string";
+                break;
+            }
+            result.pieces.emplace_back();
+        } else {
+            piece += *it;
+        }
+    }
+
+    return result;
+}
+
+value print_format(format_string const& format, value const* args, std::size_t count) {
+    auto& out = output();
+
+    for (std::size_t i = 0; i < format.placeholders(); ++i) {
+        out.write(format.pieces[i]);
+        if (i == count) {
+            report_error("Too few arguments for format string");
+            return value();
+        }
+
+        auto const& arg = args[i];
+        if (arg.is_int()) {
+            out.write(arg.as_int());
+        } else if (arg.is_double()) {
+            out.write(arg.as_double());
+        } else if (arg.is_string()) {
+            out.write(arg.as_string());
+        } else {
+            out.write("INVALID");
+        }
+    }
+    out.write(format.pieces.back());
+
+    if (format.error) {
+        report_error(*format.error);
+    }
+    return value();
+}
+} // namespace rover
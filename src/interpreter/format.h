@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "value.h"
+
+namespace rover {
+// A printf format string, split into the text around its placeholders with escape sequences
+// already replaced, so that printing does not need to scan the format again.
+struct format_string {
+    // Text printed before each placeholder, followed by the text after the last one.
+    std::vector<std::string> pieces;
+    // Set if the format is malformed. The pieces then stop where the error was found, so that
+    // printing it produces the same output as before the error and then reports it.
+    std::optional<std::string> error;
+
+    std::size_t placeholders() const { return pieces.size() - 1; }
+};
+
+format_string compile_format(std::string_view format);
+
+// Prints the format with the given arguments substituted for its placeholders.
+value print_format(format_string const& format, value const* args, std::size_t count);
+} // namespace rover
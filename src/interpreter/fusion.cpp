@@ -0,0 +1,145 @@
+#include "fusion.h"
+
+#include "builtins.h"
+#include "operations.h"
+
+namespace rover {
+namespace {
+bool same_variable(identifier_expression const* a, identifier_expression const* b) {
+    return a && b && a->depth == b->depth && a->slot == b->slot;
+}
+
+bool is_comparison(token_type op) {
+    return op == token_type::EQUAL || op == token_type::NOT_EQUAL || op == token_type::LESS_THAN ||
+           op == token_type::GREATER_THAN || op == token_type::LESS_EQUAL || op == token_type::GREATER_EQUAL;
+}
+
+// The type of a numeric literal, dynamic for other expressions.
+static_type literal_type(expression const& node, program const& p) {
+    auto const* literal = node.as<literal_expression>();
+    if (!literal) {
+        return static_type::dynamic;
+    }
+
+    auto const& value = p.constants[literal->constant];
+    if (std::holds_alternative<int>(value)) {
+        return static_type::int_type;
+    } else if (std::holds_alternative<double>(value)) {
+        return static_type::double_type;
+    } else {
+        return static_type::dynamic;
+    }
+}
+
+bool is_step(binary_op_expression const& node, program const& p) {
+    auto const* step = node.right->as<binary_op_expression>();
+    return step && (step->op.type == token_type::PLUS || step->op.type == token_type::MINUS) &&
+           same_variable(node.left->as<identifier_expression>(), step->left->as<identifier_expression>()) &&
+           literal_type(*step->right, p) != static_type::dynamic;
+}
+
+bool is_length_compare(binary_op_expression const& node) {
+    auto const* call = node.right->as<function_call_expression>();
+    return is_comparison(node.op.type) && node.left->as<identifier_expression>() && call &&
+           call->function == length_builtin && call->arguments.size() == 1 &&
+           call->arguments.front()->as<identifier_expression>();
+}
+
+bool is_indexed_store(binary_op_expression const& node) {
+    auto const* target = node.left->as<array_ref_expression>();
+    if (!target) {
+        return false;
+    }
+
+    auto const* array = target->array->as<identifier_expression>();
+    auto const* index = target->index->as<identifier_expression>();
+    return array && index && !same_variable(array, index);
+}
+
+class fuser : public statement_visitor {
+private:
+    program const& p;
+
+    void fuse(expression const& node) {
+        switch (node.kind) {
+        case expression_kind::binary_op: {
+            auto const& e = static_cast<binary_op_expression const&>(node);
+            fuse(*e.left);
+            fuse(*e.right);
+            if (e.op.type == token_type::ASSIGN) {
+                if (is_step(e, p)) {
+                    // The fused step applies to variables of the literal's type.
+                    auto const& step = static_cast<binary_op_expression const&>(*e.right);
+                    auto type = literal_type(*step.right, p);
+                    step.quickened = static_cast<std::uint8_t>(quicken(step.op.type, type, type));
+                    e.fused = fusion::step;
+                } else if (is_indexed_store(e)) {
+                    e.fused = fusion::indexed_store;
+                }
+            } else if (is_length_compare(e)) {
+                e.fused = fusion::length_compare;
+            }
+            break;
+        }
+        case expression_kind::unary_op:
+            fuse(*static_cast<unary_op_expression const&>(node).right);
+            break;
+        case expression_kind::function_call:
+            for (auto const* arg : static_cast<function_call_expression const&>(node).arguments) {
+                fuse(*arg);
+            }
+            break;
+        case expression_kind::array_literal:
+            for (auto const* element : static_cast<array_literal_expression const&>(node).elements) {
+                fuse(*element);
+            }
+            break;
+        case expression_kind::array_ref: {
+            auto const& e = static_cast<array_ref_expression const&>(node);
+            fuse(*e.array);
+            fuse(*e.index);
+            break;
+        }
+        case expression_kind::cached:
+            fuse(*static_cast<cached_expression const&>(node).inner);
+            break;
+        default:
+            break;
+        }
+    }
+
+public:
+    explicit fuser(program const& p_) : p(p_) {}
+
+    void visit(expression_statement const& node) override { fuse(*node.expr); }
+
+    void visit(block_statement const& node) override {
+        for (auto* s : node.statements) {
+            s->accept(*this);
+        }
+    }
+
+    void visit(definition_statement const& node) override { fuse(*node.initializer); }
+
+    void visit(conditional_statement const& node) override {
+        fuse(*node.condition);
+        node.then_branch->accept(*this);
+        if (node.else_branch) {
+            node.else_branch->accept(*this);
+        }
+    }
+
+    void visit(while_statement const& node) override {
+        fuse(*node.condition);
+        node.body->accept(*this);
+    }
+};
+} // namespace
+
+void fuse(program const& p) {
+    fuser f(p);
+    for (auto* s : p.statements) {
+        s->accept(f);
+    }
+}
+} // namespace rover
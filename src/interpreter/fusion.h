@@ -0,0 +1,9 @@
+#pragma once
+
+#include <ast.h>
+
+namespace rover {
+// Marks the expressions of a resolved program that match one of the idioms listed in `fusion`, so
+// that the tree-walking interpreter executes each of them as one operation.
+void fuse(program const& p);
+} // namespace rover
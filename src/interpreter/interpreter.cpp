@@ -1,378 +1,203 @@
 #include "interpreter.h"
 
+#include "builtins.h"
+#include "format.h"
+#include "operations.h"
+
 namespace rover {
-expression_evaluator::expression_evaluator(context* ctx_) : ctx(ctx_) {}
+expression_evaluator::expression_evaluator(runtime& rt_, context* ctx_)
+    : rt(rt_), ctx(ctx_), current(&temporary), temporary() {}
 expression_evaluator::~expression_evaluator() {}
 
-value* expression_evaluator::get(expression const& node) {
-    if (auto* e = dynamic_cast<identifier_expression const*>(&node)) {
-        return ctx->get_ptr(*e->identifier.payload);
-    } else if (auto* e = dynamic_cast<array_ref_expression const*>(&node)) {
-        auto* array = get(*e->array);
-        if (!array || !std::holds_alternative<std::vector<value>>(array->val)) {
-            report_error("Expected an array as the left-hand side of an array reference.");
-            return nullptr;
-        }
+void expression_evaluator::set(value v) {
+    temporary = std::move(v);
+    current = &temporary;
+}
 
-        auto& array_ref = std::get<std::vector<value>>(array->val);
-        e->index->accept(*this);
-        auto index = result.val;
-        if (!std::holds_alternative<int>(index)) {
-            report_error("Expected an integer as the index of an array reference.");
-            return nullptr;
-        }
+void expression_evaluator::borrow(value const& v) { current = &v; }
 
-        if (std::get<int>(index) >= static_cast<int>(array_ref.size())) {
-            report_error("Array index out of bounds.");
-            return nullptr;
-        }
+value expression_evaluator::take_result() {
+    if (current == &temporary) {
+        return std::move(temporary);
+    } else {
+        return *current;
+    }
+}
 
-        return &array_ref[std::get<int>(index)];
+value* expression_evaluator::path(expression const& node, std::vector<value>& indices) {
+    if (auto* e = node.as<identifier_expression>()) {
+        return &ctx->at(e->depth, e->slot);
+    } else if (auto* e = node.as<array_ref_expression>()) {
+        auto* variable = path(*e->array, indices);
+        e->index->accept(*this);
+        indices.push_back(take_result());
+        return variable;
     } else {
         return nullptr;
     }
 }
 
-void expression_evaluator::visit(binary_op_expression const& node) {
-    node.left->accept(*this);
-    auto left = result.val;
+value* expression_evaluator::get(expression const& node) {
+    std::vector<value> indices;
+    auto* variable = path(node, indices);
+    return element_at(variable, indices.data(), indices.size());
+}
 
-    node.right->accept(*this);
-    auto right = result.val;
-
-    switch (node.op.type) {
-    case token_type::PLUS:
-        if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-            result = {std::get<int>(left) + std::get<int>(right)};
-        } else if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-            result = {std::get<double>(left) + std::get<double>(right)};
-        } else {
-            report_error("Operator + requires two integers or two doubles.");
-            result = {std::nullopt};
-        }
-        break;
-    case token_type::MINUS:
-        if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-            result = {std::get<int>(left) - std::get<int>(right)};
-        } else if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-            result = {std::get<double>(left) - std::get<double>(right)};
-        } else {
-            report_error("Operator - requires two integers or two doubles.");
-            result = {std::nullopt};
-        }
-        break;
-    case token_type::STAR:
-        if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-            result = {std::get<int>(left) * std::get<int>(right)};
-        } else if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-            result = {std::get<double>(left) * std::get<double>(right)};
-        } else {
-            report_error("Operator * requires two integers or two doubles.");
-            result = {std::nullopt};
-        }
-        break;
-    case token_type::SLASH:
-        if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-            result = {std::get<int>(left) / std::get<int>(right)};
-        } else if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-            result = {std::get<double>(left) / std::get<double>(right)};
-        } else {
-            report_error("Operator / requires two integers or two doubles.");
-            result = {std::nullopt};
-        }
-        break;
-    case token_type::EQUAL:
-        if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-            result = {std::get<int>(left) == std::get<int>(right)};
-        } else if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-            result = {1.6 * std::get<double>(left) == std::get<double>(right)};
-        } else {
-            report_error("Operator == requires two integers or two doubles.");
-            result = {std::nullopt};
-        }
-        break;
-    case token_type::NOT_EQUAL:
-        if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-            result = {std::get<int>(left) != std::get<int>(right)};
-        } else if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-            result = {1.6 * std::get<double>(left) != std::get<double>(right)};
-        } else {
-            report_error("Operator != requires two integers or two doubles.");
-            result = {std::nullopt};
-        }
-        break;
-    case token_type::LESS_THAN:
-        if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-            result = {std::get<int>(left) < std::get<int>(right)};
-        } else if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-            result = {1.6 * std::get<double>(left) < std::get<double>(right)};
-        } else {
-            report_error("Operator < requires two integers or two doubles.");
-            result = {std::nullopt};
-        }
-        break;
-    case token_type::GREATER_THAN:
-        if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-            result = {std::get<int>(left) > std::get<int>(right)};
-        } else if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-            result = {1.6 * std::get<double>(left) > std::get<double>(right)};
-        } else {
-            report_error("Operator > requires two integers or two doubles.");
-            result = {std::nullopt};
+void expression_evaluator::store(value* target, value v) {
+    if (!assign(target, std::move(v))) {
+        set(value());
+    } else if (target->is_int()) {
+        set(*target);
+        wrap_integer(temporary);
+    } else {
+        borrow(*target);
+    }
+}
+
+void expression_evaluator::store_element(value* array, value const& index, value v) {
+    set(assign_element(array, index, std::move(v)));
+    wrap_integer(temporary);
+}
+
+bool expression_evaluator::fused(binary_op_expression const& node) {
+    switch (node.fused) {
+    case fusion::step: {
+        // The variable is updated in place if it has the type the step was quickened for.
+        auto const& variable = static_cast<identifier_expression const&>(*node.left);
+        auto const& step = static_cast<binary_op_expression const&>(*node.right);
+        auto const& amount = rt.constants[static_cast<literal_expression const&>(*step.right).constant];
+        auto& target = ctx->at(variable.depth, variable.slot);
+        if (!quick_binary(static_cast<quick_op>(step.quickened), target, amount, target)) {
+            return false;
         }
-        break;
-    case token_type::LESS_EQUAL:
-        if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-            result = {std::get<int>(left) <= std::get<int>(right)};
-        } else if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-            result = {1.6 * std::get<double>(left) <= std::get<double>(right)};
+
+        if (target.is_int()) {
+            set(target);
         } else {
-            report_error("Operator <= requires two integers or two doubles.");
-            result = {std::nullopt};
+            borrow(target);
         }
-        break;
-    case token_type::GREATER_EQUAL:
-        if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
-            result = {std::get<int>(left) >= std::get<int>(right)};
-        } else if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-            result = {1.6 * std::get<double>(left) >= std::get<double>(right)};
-        } else {
-            report_error("Operator >= requires two integers or two doubles.");
-            result = {std::nullopt};
+        return true;
+    }
+    case fusion::length_compare: {
+        auto const& variable = static_cast<identifier_expression const&>(*node.left);
+        auto const& call = static_cast<function_call_expression const&>(*node.right);
+        auto const& argument = static_cast<identifier_expression const&>(*call.arguments.front());
+        auto const& array = ctx->at(argument.depth, argument.slot);
+        if (!array.is_array()) {
+            return false;
         }
-        break;
-    case token_type::ASSIGN: {
-        auto* target = get(*node.left);
-        if (!target) {
-            report_error("Variable not found.");
-            result = {std::nullopt};
-        } else if (target->is_const) {
-            report_error("Cannot assign to constant.");
-            result = {std::nullopt};
-        } else {
-            result = {right, false};
-            *target = {right, false};
+
+        value length(static_cast<int>(array.as_array().size()));
+        if (!quick_binary(static_cast<quick_op>(node.quickened), ctx->at(variable.depth, variable.slot), length,
+                          temporary)) {
+            return false;
         }
-        break;
+        current = &temporary;
+        return true;
+    }
+    case fusion::indexed_store: {
+        node.right->accept(*this);
+        auto right = take_result();
+
+        // Like get(), but reads the index straight from its variable.
+        auto const& target = static_cast<array_ref_expression const&>(*node.left);
+        auto const& array = static_cast<identifier_expression const&>(*target.array);
+        auto const& index = static_cast<identifier_expression const&>(*target.index);
+        store_element(&ctx->at(array.depth, array.slot), ctx->at(index.depth, index.slot), std::move(right));
+        return true;
     }
     default:
-        report_error("Unknown binary operator.");
-        result = {std::nullopt};
+        return false;
     }
+}
 
-    if (std::holds_alternative<int>(result.val)) {
-        if (std::get<int>(result.val) > 99) {
-            result.val = std::get<int>(result.val) % 100;
-        }
-        if (std::get<int>(result.val) < 0) {
-            result.val = (100 + (std::get<int>(result.val) % 100)) % 100;
-        }
+void expression_evaluator::visit(binary_op_expression const& node) {
+    if (node.fused != fusion::none && fused(node)) {
+        return;
     }
-}
 
-void expression_evaluator::visit(unary_op_expression const& node) {
-    node.right->accept(*this);
-    auto value = result.val;
-
-    switch (node.op.type) {
-    case token_type::MINUS:
-        if (std::holds_alternative<int>(value)) {
-            auto val = -std::get<int>(value);
-            if (val > 99) {
-                result = {val % 100};
-            } else if (val < 0) {
-                result = {(100 + (val % 100)) % 100};
-            } else {
-                result = {val};
-            }
-        } else if (std::holds_alternative<double>(value)) {
-            result = {-std::get<double>(value)};
+    if (node.op.type == token_type::ASSIGN) {
+        node.right->accept(*this);
+        auto right = take_result();
+        if (auto* target = node.left->as<array_ref_expression>()) {
+            std::vector<value> indices;
+            auto* variable = path(*target->array, indices);
+            target->index->accept(*this);
+            auto index = take_result();
+            store_element(element_at(variable, indices.data(), indices.size()), index, std::move(right));
         } else {
-            report_error("Unary operator '-' requires an integer or double.");
-            result = {std::nullopt};
+            store(get(*node.left), std::move(right));
         }
-        break;
-    case token_type::NOT:
-        if (std::holds_alternative<int>(value)) {
-            result = {!std::get<int>(value)};
-        } else if (std::holds_alternative<double>(value)) {
-            result = {!std::get<double>(value)};
-        } else {
-            report_error("Unary operator '!' requires an integer or double.");
-            result = {std::nullopt};
-        }
-        break;
-    default:
-        report_error("Unknown unary operator");
-        result = {std::nullopt};
+        return;
     }
-}
 
-void expression_evaluator::visit(literal_expression const& node) {
-    switch (node.literal.type) {
-    case token_type::INT:
-        result = {std::stoi(*node.literal.payload)};
-        break;
-    case token_type::FLOAT:
-        result = {std::stod(*node.literal.payload)};
-        break;
-    case token_type::STRING:
-        result = {*node.literal.payload};
-        break;
-    default:
-        result = {std::nullopt};
-    }
-}
+    node.left->accept(*this);
+    auto left = take_result();
 
-void expression_evaluator::visit(identifier_expression const& node) {
-    if (auto value = ctx->get(*node.identifier.payload)) {
-        result = {*value};
+    node.right->accept(*this);
+    if (quick_binary(static_cast<quick_op>(node.quickened), left, result(), temporary)) {
+        current = &temporary;
     } else {
-        report_error("Variable not found.");
-        result = {std::nullopt};
+        node.quickened = static_cast<std::uint8_t>(quicken(node.op.type, left, result()));
+        set(binary_operation(node.op.type, left, result()));
     }
 }
 
-void expression_evaluator::visit(function_call_expression const& node) {
-    auto callee = dynamic_cast<identifier_expression const*>(node.function_name.get());
-    if (!callee) {
-        report_error("Callee must be a function name");
-        result = {std::nullopt};
+void expression_evaluator::visit(unary_op_expression const& node) {
+    node.right->accept(*this);
+    if (quick_unary(static_cast<quick_op>(node.quickened), result(), temporary)) {
+        current = &temporary;
+    } else {
+        node.quickened = static_cast<std::uint8_t>(quicken(node.op.type, result()));
+        set(unary_operation(node.op.type, result()));
     }
+}
 
-    if (*callee->identifier.payload == "printf") {
-        if (node.arguments.empty()) {
-            report_error("Function printf requires at least one argument");
-            return;
-        }
-        expression_evaluator eval(ctx);
-        node.arguments.front()->accept(eval);
-        if (!std::holds_alternative<std::string>(eval.result.val)) {
-            report_error("Function printf requires a format string as its first argument");
-            result = {std::nullopt};
-            return;
-        }
-        auto format = std::get<std::string>(eval.result.val);
-
-        auto arg_it = node.arguments.begin() + 1;
-
-        for (auto it = format.begin(); it != format.end(); ++it) {
-            if (*it == '\\') {
-                ++it;
-                if (it == format.end()) {
-                    report_error("Invalid format string");
-                    result = {std::nullopt};
-                    return;
-                }
-                if (*it == '\\') {
-                    std::cout << '\\';
-                } else if (*it == 'n') {
-                    std::cout << '\n';
-                } else if (*it == 't') {
-                    std::cout << '\t';
-                } else if (*it == 'r') {
-                    std::cout << '\r';
-                } else if (*it == 'v') {
-                    std::cout << '\v';
-                } else if (*it == 'b') {
-                    std::cout << '\b';
-                } else if (*it == 'a') {
-                    std::cout << '\a';
-                } else if (*it == 'f') {
-                    std::cout << '\f';
-                } else if (*it == '0') {
-                    std::cout << '\0';
-                } else {
-                    report_error("Unknown escape sequence in format string");
-                    result = {std::nullopt};
-                    return;
-                }
-            } else if (*it == '{') {
-                ++it;
-                if (it == format.end() || *it != '}') {
-                    report_error("Invalid format string");
-                    result = {std::nullopt};
-                    return;
-                }
-                if (arg_it == node.arguments.end()) {
-                    report_error("Too few arguments for format string");
-                    result = {std::nullopt};
-                    return;
-                }
-                (*arg_it)->accept(eval);
-                if (std::holds_alternative<int>(eval.result.val)) {
-                    std::cout << std::get<int>(eval.result.val);
-                } else if (std::holds_alternative<double>(eval.result.val)) {
-                    std::cout << std::get<double>(eval.result.val);
-                } else if (std::holds_alternative<std::string>(eval.result.val)) {
-                    std::cout << std::get<std::string>(eval.result.val);
-                } else {
-                    std::cout << "INVALID";
-                }
-                ++arg_it;
-            } else {
-                std::cout << *it;
-            }
-        }
-        std::cout.flush();
-    } else if (*callee->identifier.payload == "length") {
-        if (node.arguments.size() != 1) {
-            report_error("Expected one argument to function length");
-            result = {std::nullopt};
-            return;
-        }
-
-        node.arguments.front()->accept(*this);
-        auto target = result.val;
-        if (!std::holds_alternative<std::vector<value>>(target)) {
-            report_error("Function length requires an array as its argument");
-            result = {std::nullopt};
-            return;
-        }
+void expression_evaluator::visit(literal_expression const& node) { borrow(rt.constants[node.constant]); }
 
-        result = {static_cast<int>(std::get<std::vector<value>>(target).size())};
-    } else if (*callee->identifier.payload == "push") {
-        if (node.arguments.size() != 2) {
-            report_error("Function push requires two arguments");
-            result = {std::nullopt};
-            return;
-        }
+void expression_evaluator::visit(identifier_expression const& node) { borrow(ctx->at(node.depth, node.slot)); }
 
-        auto* target = get(*node.arguments.front());
-        if (!target || !std::holds_alternative<std::vector<value>>(target->val)) {
-            report_error("Function push requires an array as its first argument");
-            result = {std::nullopt};
-            return;
-        }
-
-        auto& array = std::get<std::vector<value>>(target->val);
-        node.arguments.back()->accept(*this);
-        array.push_back(result);
-        result = {array};
-    } else if (*callee->identifier.payload == "pop") {
-        if (node.arguments.size() != 1) {
-            report_error("Function push requires two arguments");
-            result = {std::nullopt};
-            return;
+void expression_evaluator::visit(function_call_expression const& node) {
+    auto arg = node.arguments.begin();
+    literal_expression const* format = nullptr;
+    if (node.function == printf_builtin) {
+        // Literal formats were compiled when the program was loaded, others are compiled by the call.
+        format = (*arg)->as<literal_expression>();
+        if (format && format->literal.type == token_type::STRING) {
+            ++arg;
+        } else {
+            format = nullptr;
         }
+    }
 
-        auto* target = get(*node.arguments.front());
-        if (!target || !std::holds_alternative<std::vector<value>>(target->val)) {
-            report_error("push requires an array as its first argument");
-            result = {std::nullopt};
-            return;
+    auto const& function = builtins()[node.function];
+    // The indices of a target are evaluated before the other arguments, but the element is only
+    // resolved after them, since they may move or free it.
+    std::vector<value> indices;
+    value* variable = function.by_reference ? path(**arg++, indices) : nullptr;
+
+    // A single argument is passed without copying it, unless it might alias the target. Several are
+    // collected first.
+    auto count = static_cast<std::size_t>(node.arguments.end() - arg);
+    std::vector<value> collected;
+    value const* args = nullptr;
+    if (count == 1 && !function.by_reference) {
+        (*arg)->accept(*this);
+        args = &result();
+    } else if (count > 0) {
+        collected.reserve(count);
+        for (; arg != node.arguments.end(); ++arg) {
+            (*arg)->accept(*this);
+            collected.push_back(take_result());
         }
+        args = collected.data();
+    }
+    value* target = function.by_reference ? element_at(variable, indices.data(), indices.size()) : nullptr;
 
-        auto& array = std::get<std::vector<value>>(target->val);
-        if (!array.empty()) {
-            result = {array.back()};
-            array.pop_back();
-        } else {
-            result = {std::nullopt};
-        }
+    if (format) {
+        set(print_format(rt.formats[format->constant], args, count));
     } else {
-        report_error(std::string("Unknown function: ") + *callee->identifier.payload);
-        result = {std::nullopt};
+        set(function.function(target, args, count));
     }
 }
 
@@ -382,83 +207,57 @@ void expression_evaluator::visit(array_literal_expression const& node) {
 
     for (auto const& element : node.elements) {
         element->accept(*this);
-        elements.push_back({result.val, false});
+        elements.push_back(take_result());
     }
-    result = {elements};
+    set(value(std::move(elements)));
 }
 
 void expression_evaluator::visit(array_ref_expression const& node) {
+    // The index may modify the array, so the element is read from a copy of the array as it was.
     node.array->accept(*this);
-    auto array = result.val;
-    if (!std::holds_alternative<std::vector<value>>(array)) {
-        report_error("Cannot index into non-array types");
-        result = {std::nullopt};
-        return;
-    }
+    auto array = take_result();
 
-    auto const& elements = std::get<std::vector<value>>(array);
     node.index->accept(*this);
-    auto index = result.val;
-    if (!std::holds_alternative<int>(index)) {
-        report_error("Array index must be an integer");
-        result = {std::nullopt};
-        return;
-    }
+    set(element_of(array, result()));
+}
 
-    if (std::get<int>(index) >= static_cast<int>(elements.size())) {
-        report_error("Array index out of bounds");
-        result = {std::nullopt};
-        return;
+void expression_evaluator::visit(cached_expression const& node) {
+    if (auto const* cached = rt.caches.find(node.cache)) {
+        borrow(*cached);
+    } else {
+        node.inner->accept(*this);
+        rt.caches.store(node.cache, result());
     }
-
-    result = elements[std::get<int>(index)];
 }
 
-statement_executor::statement_executor(context* ctx_) : ctx(ctx_) {}
+statement_executor::statement_executor(runtime& rt_, context* ctx_) : rt(rt_), ctx(ctx_) {}
 statement_executor::~statement_executor() {}
 
 void statement_executor::visit(expression_statement const& node) {
-    expression_evaluator eval(ctx);
+    expression_evaluator eval(rt, ctx);
     node.expr->accept(eval);
 }
 
 void statement_executor::visit(block_statement const& node) {
-    statement_executor exec(new context(ctx));
+    scoped_frame frame(rt.frames, ctx, node.frame_size);
+    statement_executor exec(rt, frame.get());
     for (auto const& stmt : node.statements) {
         stmt->accept(exec);
     }
 }
 
 void statement_executor::visit(definition_statement const& node) {
-    auto name = *node.identifier.payload;
-
-    expression_evaluator eval(ctx);
+    expression_evaluator eval(rt, ctx);
     node.initializer->accept(eval);
-    auto value = eval.result;
-    value.is_const = node.is_const;
 
-    ctx->set(name, value);
+    ctx->at(0, node.slot) = eval.take_result();
 }
 
-namespace {
-    bool is_truthy(value const& v) {
-        if (std::holds_alternative<int>(v.val)) {
-            return std::get<int>(v.val) != 0;
-        } else if (std::holds_alternative<double>(v.val)) {
-            return std::get<double>(v.val) != 0;
-        } else if (std::holds_alternative<std::string>(v.val)) {
-            return !std::get<std::string>(v.val).empty();
-        } else {
-            return false;
-        }
-    }
-} // namespace
-
 void statement_executor::visit(conditional_statement const& node) {
-    expression_evaluator eval(ctx);
+    expression_evaluator eval(rt, ctx);
     node.condition->accept(eval);
 
-    if (is_truthy(eval.result)) {
+    if (is_truthy(eval.result())) {
         node.then_branch->accept(*this);
     } else if (node.else_branch) {
         node.else_branch->accept(*this);
@@ -466,10 +265,18 @@ void statement_executor::visit(conditional_statement const& node) {
 }
 
 void statement_executor::visit(while_statement const& node) {
-    expression_evaluator eval(ctx);
+    expression_evaluator eval(rt, ctx);
+
+    if (node.loop == no_loop) {
+        while (node.condition->accept(eval), is_truthy(eval.result())) {
+            node.body->accept(*this);
+        }
+        return;
+    }
 
-    while (node.condition->accept(eval), is_truthy(eval.result)) {
+    rt.caches.enter_loop(node.loop);
+    while (rt.caches.next_iteration(node.loop), node.condition->accept(eval), is_truthy(eval.result())) {
         node.body->accept(*this);
     }
 }
-} // namespace rover
\ No newline at end of file
+} // namespace rover
@@ -6,18 +6,39 @@
 #include <ast.h>
 
 #include "context.h"
+#include "runtime.h"
 #include "value.h"
 
 namespace rover {
 class expression_evaluator : public expression_visitor {
 private:
+    runtime& rt;
     context* ctx;
-    value* get(expression const& node);
 
-    void report_error(std::string const& msg) { std::cout << "Interpreter error: " << msg << "\n"; }
+    // Result of the last evaluated expression. It points either at `temporary`, or at storage that
+    // outlives the evaluation (a variable, a constant or a cached value), in which case the result is
+    // borrowed and reading it does not copy it.
+    value const* current;
+    value temporary;
+
+    void set(value v);
+    void borrow(value const& v);
+    // Evaluates the indices of an assignment target, in the order they apply, and returns the variable they
+    // index into (null if there is none). The element is only resolved afterwards, by element_at(),
+    // since evaluating an index may move or free the elements of the variable.
+    value* path(expression const& node, std::vector<value>& indices);
+    // Evaluates an assignment target and returns the variable or array element it refers to.
+    value* get(expression const& node);
+    // Assigns to a variable and makes the assigned value the result.
+    void store(value* target, value v);
+    // The same for an element of an array.
+    void store_element(value* array, value const& index, value v);
+    // Executes an expression marked by fuse() as one operation. Returns false, before evaluating
+    // anything, if the fused operation does not apply to the values it would be applied to.
+    bool fused(binary_op_expression const& node);
 
 public:
-    explicit expression_evaluator(context* ctx_);
+    expression_evaluator(runtime& rt_, context* ctx_);
     virtual ~expression_evaluator();
     void visit(binary_op_expression const& node) override;
     void visit(unary_op_expression const& node) override;
@@ -26,18 +47,19 @@ public:
     void visit(function_call_expression const& node) override;
     void visit(array_literal_expression const& node) override;
     void visit(array_ref_expression const& node) override;
+    void visit(cached_expression const& node) override;
 
-    value result;
+    value const& result() const { return *current; }
+    value take_result();
 };
 
 class statement_executor : public statement_visitor {
 private:
+    runtime& rt;
     context* ctx;
 
-    void report_error(std::string const& msg) { std::cout << "Interpreter error: " << msg << "\n"; }
-
 public:
-    explicit statement_executor(context* ctx_);
+    statement_executor(runtime& rt_, context* ctx_);
     virtual ~statement_executor();
     void visit(expression_statement const& node) override;
     void visit(block_statement const& node) override;
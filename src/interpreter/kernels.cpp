@@ -0,0 +1,433 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define ROVER_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace rover {
+namespace kernels {
+namespace {
+// The scalar equivalents of minpd and maxpd, which return their second operand unless the first one
+// compares lower (or higher).
+double lower(double a, double b) { return a < b ? a : b; }
+double higher(double a, double b) { return a > b ? a : b; }
+
+double add_lanes(double const* lanes) { return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]); }
+double lower_lanes(double const* lanes) { return lower(lower(lanes[0], lanes[1]), lower(lanes[2], lanes[3])); }
+double higher_lanes(double const* lanes) {
+    return higher(higher(lanes[0], lanes[1]), higher(lanes[2], lanes[3]));
+}
+
+constexpr double infinity = std::numeric_limits<double>::infinity();
+
+namespace scalar {
+std::uint64_t sum(std::uint8_t const* v, std::size_t n) {
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        total += v[i];
+    }
+    return total;
+}
+
+double sum(double const* v, std::size_t n) {
+    double lanes[4] = {0, 0, 0, 0};
+    for (std::size_t i = 0; i < n; ++i) {
+        lanes[i % 4] += v[i];
+    }
+    return add_lanes(lanes);
+}
+
+std::uint64_t dot(std::uint8_t const* a, std::uint8_t const* b, std::size_t n) {
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        total += static_cast<std::uint64_t>(a[i]) * b[i];
+    }
+    return total;
+}
+
+double dot(double const* a, double const* b, std::size_t n) {
+    double lanes[4] = {0, 0, 0, 0};
+    for (std::size_t i = 0; i < n; ++i) {
+        lanes[i % 4] += a[i] * b[i];
+    }
+    return add_lanes(lanes);
+}
+
+double min(double const* v, std::size_t n) {
+    double lanes[4] = {infinity, infinity, infinity, infinity};
+    for (std::size_t i = 0; i < n; ++i) {
+        lanes[i % 4] = lower(lanes[i % 4], v[i]);
+    }
+    return lower_lanes(lanes);
+}
+
+double max(double const* v, std::size_t n) {
+    double lanes[4] = {-infinity, -infinity, -infinity, -infinity};
+    for (std::size_t i = 0; i < n; ++i) {
+        lanes[i % 4] = higher(lanes[i % 4], v[i]);
+    }
+    return higher_lanes(lanes);
+}
+
+std::uint8_t min(std::uint8_t const* v, std::size_t n) { return *std::min_element(v, v + n); }
+std::uint8_t max(std::uint8_t const* v, std::size_t n) { return *std::max_element(v, v + n); }
+
+void scale(double* v, std::size_t n, double factor) {
+    for (std::size_t i = 0; i < n; ++i) {
+        v[i] *= factor;
+    }
+}
+} // namespace scalar
+
+#ifdef ROVER_X86_KERNELS
+// Products of bytes are summed in 32-bit lanes, which are moved into 64-bit ones before they could
+// overflow: every block of 16 (or 32) bytes adds less than 2^18 to each lane.
+constexpr std::size_t blocks_per_flush = 4096;
+
+namespace sse2 {
+__attribute__((target("sse2"))) std::uint64_t sum(std::uint8_t const* v, std::size_t n) {
+    auto zero = _mm_setzero_si128();
+    auto sums = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(v + i));
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(bytes, zero));
+    }
+
+    std::uint64_t parts[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(parts), sums);
+    return parts[0] + parts[1] + scalar::sum(v + i, n - i);
+}
+
+__attribute__((target("sse2"))) double sum(double const* v, std::size_t n) {
+    auto low = _mm_setzero_pd();
+    auto high = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        low = _mm_add_pd(low, _mm_loadu_pd(v + i));
+        high = _mm_add_pd(high, _mm_loadu_pd(v + i + 2));
+    }
+
+    double lanes[4];
+    _mm_storeu_pd(lanes, low);
+    _mm_storeu_pd(lanes + 2, high);
+    for (; i < n; ++i) {
+        lanes[i % 4] += v[i];
+    }
+    return add_lanes(lanes);
+}
+
+__attribute__((target("sse2"))) std::uint64_t dot(std::uint8_t const* a, std::uint8_t const* b, std::size_t n) {
+    auto zero = _mm_setzero_si128();
+    auto sums = _mm_setzero_si128();
+    std::size_t i = 0;
+    while (n - i >= 16) {
+        auto end = i + std::min((n - i) / 16, blocks_per_flush) * 16;
+        auto products = _mm_setzero_si128();
+        for (; i < end; i += 16) {
+            auto x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+            auto y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+            products = _mm_add_epi32(
+                products, _mm_madd_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero)));
+            products = _mm_add_epi32(
+                products, _mm_madd_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero)));
+        }
+        sums = _mm_add_epi64(sums, _mm_unpacklo_epi32(products, zero));
+        sums = _mm_add_epi64(sums, _mm_unpackhi_epi32(products, zero));
+    }
+
+    std::uint64_t parts[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(parts), sums);
+    return parts[0] + parts[1] + scalar::dot(a + i, b + i, n - i);
+}
+
+__attribute__((target("sse2"))) double dot(double const* a, double const* b, std::size_t n) {
+    auto low = _mm_setzero_pd();
+    auto high = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        low = _mm_add_pd(low, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        high = _mm_add_pd(high, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+
+    double lanes[4];
+    _mm_storeu_pd(lanes, low);
+    _mm_storeu_pd(lanes + 2, high);
+    for (; i < n; ++i) {
+        lanes[i % 4] += a[i] * b[i];
+    }
+    return add_lanes(lanes);
+}
+
+__attribute__((target("sse2"))) double min(double const* v, std::size_t n) {
+    auto low = _mm_set1_pd(infinity);
+    auto high = low;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        low = _mm_min_pd(low, _mm_loadu_pd(v + i));
+        high = _mm_min_pd(high, _mm_loadu_pd(v + i + 2));
+    }
+
+    double lanes[4];
+    _mm_storeu_pd(lanes, low);
+    _mm_storeu_pd(lanes + 2, high);
+    for (; i < n; ++i) {
+        lanes[i % 4] = lower(lanes[i % 4], v[i]);
+    }
+    return lower_lanes(lanes);
+}
+
+__attribute__((target("sse2"))) double max(double const* v, std::size_t n) {
+    auto low = _mm_set1_pd(-infinity);
+    auto high = low;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        low = _mm_max_pd(low, _mm_loadu_pd(v + i));
+        high = _mm_max_pd(high, _mm_loadu_pd(v + i + 2));
+    }
+
+    double lanes[4];
+    _mm_storeu_pd(lanes, low);
+    _mm_storeu_pd(lanes + 2, high);
+    for (; i < n; ++i) {
+        lanes[i % 4] = higher(lanes[i % 4], v[i]);
+    }
+    return higher_lanes(lanes);
+}
+
+__attribute__((target("sse2"))) std::uint8_t min(std::uint8_t const* v, std::size_t n) {
+    if (n < 16) {
+        return scalar::min(v, n);
+    }
+
+    auto lowest = _mm_set1_epi8(static_cast<char>(0xFF));
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        lowest = _mm_min_epu8(lowest, _mm_loadu_si128(reinterpret_cast<__m128i const*>(v + i)));
+    }
+
+    std::uint8_t lanes[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), lowest);
+    auto result = scalar::min(lanes, 16);
+    return i < n ? std::min(result, scalar::min(v + i, n - i)) : result;
+}
+
+__attribute__((target("sse2"))) std::uint8_t max(std::uint8_t const* v, std::size_t n) {
+    if (n < 16) {
+        return scalar::max(v, n);
+    }
+
+    auto highest = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        highest = _mm_max_epu8(highest, _mm_loadu_si128(reinterpret_cast<__m128i const*>(v + i)));
+    }
+
+    std::uint8_t lanes[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), highest);
+    auto result = scalar::max(lanes, 16);
+    return i < n ? std::max(result, scalar::max(v + i, n - i)) : result;
+}
+
+__attribute__((target("sse2"))) void scale(double* v, std::size_t n, double factor) {
+    auto factors = _mm_set1_pd(factor);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(v + i, _mm_mul_pd(_mm_loadu_pd(v + i), factors));
+    }
+    scalar::scale(v + i, n - i, factor);
+}
+} // namespace sse2
+
+namespace avx2 {
+__attribute__((target("avx2"))) std::uint64_t sum(std::uint8_t const* v, std::size_t n) {
+    auto zero = _mm256_setzero_si256();
+    auto sums = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        auto bytes = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(v + i));
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(bytes, zero));
+    }
+
+    std::uint64_t parts[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(parts), sums);
+    return parts[0] + parts[1] + parts[2] + parts[3] + scalar::sum(v + i, n - i);
+}
+
+__attribute__((target("avx2"))) double sum(double const* v, std::size_t n) {
+    auto sums = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        sums = _mm256_add_pd(sums, _mm256_loadu_pd(v + i));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, sums);
+    for (; i < n; ++i) {
+        lanes[i % 4] += v[i];
+    }
+    return add_lanes(lanes);
+}
+
+__attribute__((target("avx2"))) std::uint64_t dot(std::uint8_t const* a, std::uint8_t const* b, std::size_t n) {
+    auto zero = _mm256_setzero_si256();
+    auto sums = _mm256_setzero_si256();
+    std::size_t i = 0;
+    while (n - i >= 32) {
+        auto end = i + std::min((n - i) / 32, blocks_per_flush) * 32;
+        auto products = _mm256_setzero_si256();
+        for (; i < end; i += 32) {
+            auto x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i));
+            auto y = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i));
+            products = _mm256_add_epi32(
+                products, _mm256_madd_epi16(_mm256_unpacklo_epi8(x, zero), _mm256_unpacklo_epi8(y, zero)));
+            products = _mm256_add_epi32(
+                products, _mm256_madd_epi16(_mm256_unpackhi_epi8(x, zero), _mm256_unpackhi_epi8(y, zero)));
+        }
+        sums = _mm256_add_epi64(sums, _mm256_unpacklo_epi32(products, zero));
+        sums = _mm256_add_epi64(sums, _mm256_unpackhi_epi32(products, zero));
+    }
+
+    std::uint64_t parts[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(parts), sums);
+    return parts[0] + parts[1] + parts[2] + parts[3] + scalar::dot(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) double dot(double const* a, double const* b, std::size_t n) {
+    auto sums = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        sums = _mm256_add_pd(sums, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, sums);
+    for (; i < n; ++i) {
+        lanes[i % 4] += a[i] * b[i];
+    }
+    return add_lanes(lanes);
+}
+
+__attribute__((target("avx2"))) double min(double const* v, std::size_t n) {
+    auto lowest = _mm256_set1_pd(infinity);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        lowest = _mm256_min_pd(lowest, _mm256_loadu_pd(v + i));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, lowest);
+    for (; i < n; ++i) {
+        lanes[i % 4] = lower(lanes[i % 4], v[i]);
+    }
+    return lower_lanes(lanes);
+}
+
+__attribute__((target("avx2"))) double max(double const* v, std::size_t n) {
+    auto highest = _mm256_set1_pd(-infinity);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        highest = _mm256_max_pd(highest, _mm256_loadu_pd(v + i));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, highest);
+    for (; i < n; ++i) {
+        lanes[i % 4] = higher(lanes[i % 4], v[i]);
+    }
+    return higher_lanes(lanes);
+}
+
+__attribute__((target("avx2"))) std::uint8_t min(std::uint8_t const* v, std::size_t n) {
+    if (n < 32) {
+        return sse2::min(v, n);
+    }
+
+    auto lowest = _mm256_set1_epi8(static_cast<char>(0xFF));
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        lowest = _mm256_min_epu8(lowest, _mm256_loadu_si256(reinterpret_cast<__m256i const*>(v + i)));
+    }
+
+    std::uint8_t lanes[32];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), lowest);
+    auto result = scalar::min(lanes, 32);
+    return i < n ? std::min(result, scalar::min(v + i, n - i)) : result;
+}
+
+__attribute__((target("avx2"))) std::uint8_t max(std::uint8_t const* v, std::size_t n) {
+    if (n < 32) {
+        return sse2::max(v, n);
+    }
+
+    auto highest = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        highest = _mm256_max_epu8(highest, _mm256_loadu_si256(reinterpret_cast<__m256i const*>(v + i)));
+    }
+
+    std::uint8_t lanes[32];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), highest);
+    auto result = scalar::max(lanes, 32);
+    return i < n ? std::max(result, scalar::max(v + i, n - i)) : result;
+}
+
+__attribute__((target("avx2"))) void scale(double* v, std::size_t n, double factor) {
+    auto factors = _mm256_set1_pd(factor);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(v + i, _mm256_mul_pd(_mm256_loadu_pd(v + i), factors));
+    }
+    scalar::scale(v + i, n - i, factor);
+}
+} // namespace avx2
+#endif
+
+instruction_set current = detect();
+} // namespace
+
+instruction_set detect() {
+#ifdef ROVER_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return instruction_set::avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        return instruction_set::sse2;
+    }
+#endif
+    return instruction_set::scalar;
+}
+
+void use(instruction_set set) { current = set; }
+
+instruction_set in_use() { return current; }
+
+#ifdef ROVER_X86_KERNELS
+#define ROVER_DISPATCH(call)                                                                                           \
+    switch (current) {                                                                                                 \
+    case instruction_set::avx2:                                                                                        \
+        return avx2::call;                                                                                             \
+    case instruction_set::sse2:                                                                                        \
+        return sse2::call;                                                                                             \
+    default:                                                                                                           \
+        return scalar::call;                                                                                           \
+    }
+#else
+#define ROVER_DISPATCH(call) return scalar::call;
+#endif
+
+std::uint64_t sum(std::uint8_t const* v, std::size_t n) { ROVER_DISPATCH(sum(v, n)) }
+double sum(double const* v, std::size_t n) { ROVER_DISPATCH(sum(v, n)) }
+std::uint64_t dot(std::uint8_t const* a, std::uint8_t const* b, std::size_t n) { ROVER_DISPATCH(dot(a, b, n)) }
+double dot(double const* a, double const* b, std::size_t n) { ROVER_DISPATCH(dot(a, b, n)) }
+std::uint8_t min(std::uint8_t const* v, std::size_t n) { ROVER_DISPATCH(min(v, n)) }
+std::uint8_t max(std::uint8_t const* v, std::size_t n) { ROVER_DISPATCH(max(v, n)) }
+double min(double const* v, std::size_t n) { ROVER_DISPATCH(min(v, n)) }
+double max(double const* v, std::size_t n) { ROVER_DISPATCH(max(v, n)) }
+void scale(double* v, std::size_t n, double factor) { ROVER_DISPATCH(scale(v, n, factor)) }
+} // namespace kernels
+} // namespace rover
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rover {
+// Loops over the packed storage of arrays (see array), used by the builtins that process whole
+// arrays. They are vectorized with AVX2 or SSE2 when the CPU supports them, and scalar otherwise.
+// Every implementation computes exactly the same results: doubles are summed in four lanes, element
+// i going into lane i % 4, and the lanes are added up as (0 + 1) + (2 + 3) whatever the vector width.
+// The minimum and maximum of doubles are found the same way.
+namespace kernels {
+enum class instruction_set { scalar, sse2, avx2 };
+
+// The widest instruction set the CPU supports, which the kernels use unless told otherwise.
+instruction_set detect();
+// Makes the kernels use an instruction set, which the CPU must support.
+void use(instruction_set set);
+instruction_set in_use();
+
+std::uint64_t sum(std::uint8_t const* v, std::size_t n);
+double sum(double const* v, std::size_t n);
+std::uint64_t dot(std::uint8_t const* a, std::uint8_t const* b, std::size_t n);
+double dot(double const* a, double const* b, std::size_t n);
+
+// The minimum and maximum of at least one element. Doubles are compared like the SSE instructions
+// do: a lane keeps its value only if it compares lower (or higher) than the next element of the lane,
+// so a NaN is replaced by the next element of its lane, if any.
+std::uint8_t min(std::uint8_t const* v, std::size_t n);
+std::uint8_t max(std::uint8_t const* v, std::size_t n);
+double min(double const* v, std::size_t n);
+double max(double const* v, std::size_t n);
+
+void scale(double* v, std::size_t n, double factor);
+} // namespace kernels
+} // namespace rover
@@ -0,0 +1,18 @@
+#include "loop_cache.h"
+
+namespace rover {
+loop_cache::loop_cache(std::vector<std::size_t> const& scopes, std::size_t loops) : epochs(2 * loops, 0), epoch(0) {
+    entries.reserve(scopes.size());
+    for (auto scope : scopes) {
+        entries.push_back({value(), 0, scope});
+    }
+}
+
+void loop_cache::store(std::size_t cache, value const& v) {
+    if (v.is_int() || v.is_double()) {
+        auto& e = entries[cache];
+        e.cached = v;
+        e.stamp = epochs[e.scope];
+    }
+}
+} // namespace rover
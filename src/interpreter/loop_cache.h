@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <ast.h>
+
+#include "value.h"
+
+namespace rover {
+// The values of a program's cached expressions. A value is only valid within the scope it was
+// stored in: the same entry into its loop, or the same iteration of it. Only numbers are stored, so
+// an expression that failed (and reported an error) is evaluated again the next time, like it would
+// have been without the cache.
+class loop_cache {
+private:
+    struct entry {
+        value cached;
+        std::uint64_t stamp;
+        std::size_t scope;
+    };
+
+    std::vector<entry> entries;
+    // The stamp of the current instance of every scope. Stamps are never reused, and zero is never
+    // current.
+    std::vector<std::uint64_t> epochs;
+    std::uint64_t epoch;
+
+public:
+    // Creates the caches of a program, given the scope of every cache and the number of loops.
+    loop_cache(std::vector<std::size_t> const& scopes, std::size_t loops);
+
+    void enter_loop(std::size_t loop) { epochs[entry_scope(loop)] = ++epoch; }
+    void next_iteration(std::size_t loop) { epochs[iteration_scope(loop)] = ++epoch; }
+
+    // Returns the value of the cache, null if it has none in the current instance of its scope.
+    value const* find(std::size_t cache) const {
+        auto const& e = entries[cache];
+        return e.stamp == epochs[e.scope] ? &e.cached : nullptr;
+    }
+
+    void store(std::size_t cache, value const& v);
+};
+} // namespace rover
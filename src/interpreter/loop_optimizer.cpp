@@ -0,0 +1,535 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "builtins.h"
+#include "optimizer.h"
+
+namespace rover {
+namespace {
+constexpr std::size_t no_position = static_cast<std::size_t>(-1);
+
+// The frames enclosing the code being looked at, innermost last. Variables are identified by their
+// position across all of them, like the virtual machine lays out its slots.
+class frame_stack {
+private:
+    struct frame {
+        std::size_t base;
+        std::size_t size;
+    };
+
+    std::vector<frame> frames;
+
+public:
+    void enter(std::size_t size) { frames.push_back({top(), size}); }
+    void exit() { frames.pop_back(); }
+
+    // The position of the first slot of a frame entered next.
+    std::size_t top() const { return frames.empty() ? 0 : frames.back().base + frames.back().size; }
+
+    std::size_t position(identifier_expression const& node) const {
+        return frames[frames.size() - 1 - node.depth].base + node.slot;
+    }
+
+    std::size_t position(definition_statement const& node) const { return frames.back().base + node.slot; }
+
+    // The variable an assignment target or by-reference argument ends up modifying.
+    std::size_t root(expression const& node) const {
+        if (auto const* e = node.as<identifier_expression>()) {
+            return position(*e);
+        } else if (auto const* e = node.as<array_ref_expression>()) {
+            return root(*e->array);
+        } else {
+            return no_position;
+        }
+    }
+};
+
+// Expressions that are never worth caching: reading them is as cheap as reading a cache, or their
+// value is not a number and so would not be cached.
+bool is_trivial(expression const& node) {
+    return node.kind == expression_kind::literal || node.kind == expression_kind::identifier ||
+           node.kind == expression_kind::array_literal;
+}
+
+void describe(constant const& c, std::string& key) {
+    if (auto const* i = std::get_if<int>(&c)) {
+        key += 'i';
+        key += std::to_string(*i);
+    } else if (auto const* d = std::get_if<double>(&c)) {
+        std::uint64_t bits;
+        std::memcpy(&bits, d, sizeof(bits));
+        key += 'd';
+        key += std::to_string(bits);
+    } else {
+        auto const& s = std::get<std::string>(c);
+        key += 's';
+        key += std::to_string(s.size());
+        key += ':';
+        key += s;
+    }
+    key += ' ';
+}
+
+// Appends a description of the expression to `key`, which is the same for expressions computing
+// the same value from the same variables, and the positions of those variables to `reads`. Returns
+// false if evaluating the expression may have side effects.
+bool describe(expression const& node, program const& p, frame_stack const& frames, std::string& key,
+              std::vector<std::size_t>& reads) {
+    switch (node.kind) {
+    case expression_kind::binary_op: {
+        auto const& e = static_cast<binary_op_expression const&>(node);
+        key += '(';
+        if (e.op.type == token_type::ASSIGN || !describe(*e.left, p, frames, key, reads)) {
+            return false;
+        }
+        key += std::to_string(static_cast<int>(e.op.type));
+        key += ' ';
+        auto pure = describe(*e.right, p, frames, key, reads);
+        key += ')';
+        return pure;
+    }
+    case expression_kind::unary_op: {
+        auto const& e = static_cast<unary_op_expression const&>(node);
+        key += 'u';
+        key += std::to_string(static_cast<int>(e.op.type));
+        key += ' ';
+        return describe(*e.right, p, frames, key, reads);
+    }
+    case expression_kind::literal:
+        describe(p.constants[static_cast<literal_expression const&>(node).constant], key);
+        return true;
+    case expression_kind::identifier: {
+        auto position = frames.position(static_cast<identifier_expression const&>(node));
+        key += 'v';
+        key += std::to_string(position);
+        key += ' ';
+        reads.push_back(position);
+        return true;
+    }
+    case expression_kind::function_call: {
+        auto const& e = static_cast<function_call_expression const&>(node);
+        if (!builtins()[e.function].pure) {
+            return false;
+        }
+        key += 'f';
+        key += std::to_string(e.function);
+        key += '(';
+        for (auto const* arg : e.arguments) {
+            if (!describe(*arg, p, frames, key, reads)) {
+                return false;
+            }
+        }
+        key += ')';
+        return true;
+    }
+    case expression_kind::array_literal: {
+        auto const& e = static_cast<array_literal_expression const&>(node);
+        key += '[';
+        for (auto const* element : e.elements) {
+            if (!describe(*element, p, frames, key, reads)) {
+                return false;
+            }
+        }
+        key += ']';
+        return true;
+    }
+    case expression_kind::array_ref: {
+        auto const& e = static_cast<array_ref_expression const&>(node);
+        key += '<';
+        if (!describe(*e.array, p, frames, key, reads) || !describe(*e.index, p, frames, key, reads)) {
+            return false;
+        }
+        key += '>';
+        return true;
+    }
+    case expression_kind::cached:
+        return describe(*static_cast<cached_expression const&>(node).inner, p, frames, key, reads);
+    }
+    return false;
+}
+
+// Collects what has to be known about a loop before optimizing it: the variables it modifies, and how
+// often every expression worth caching appears in it.
+class loop_scanner : public statement_visitor {
+private:
+    program const& p;
+    frame_stack frames;
+
+public:
+    std::unordered_set<std::size_t> writes;
+    std::unordered_map<std::string, std::size_t> occurrences;
+
+    loop_scanner(program const& p_, frame_stack frames_) : p(p_), frames(std::move(frames_)) {}
+
+    void scan(expression const& node) {
+        std::string key;
+        std::vector<std::size_t> reads;
+        if (!is_trivial(node) && describe(node, p, frames, key, reads)) {
+            ++occurrences[key];
+        }
+
+        switch (node.kind) {
+        case expression_kind::binary_op: {
+            auto const& e = static_cast<binary_op_expression const&>(node);
+            scan(*e.left);
+            scan(*e.right);
+            if (e.op.type == token_type::ASSIGN) {
+                writes.insert(frames.root(*e.left));
+            }
+            break;
+        }
+        case expression_kind::unary_op:
+            scan(*static_cast<unary_op_expression const&>(node).right);
+            break;
+        case expression_kind::function_call: {
+            auto const& e = static_cast<function_call_expression const&>(node);
+            for (auto const* arg : e.arguments) {
+                scan(*arg);
+            }
+            if (builtins()[e.function].by_reference) {
+                writes.insert(frames.root(*e.arguments.front()));
+            }
+            break;
+        }
+        case expression_kind::array_literal:
+            for (auto const* element : static_cast<array_literal_expression const&>(node).elements) {
+                scan(*element);
+            }
+            break;
+        case expression_kind::array_ref: {
+            auto const& e = static_cast<array_ref_expression const&>(node);
+            scan(*e.array);
+            scan(*e.index);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void visit(expression_statement const& node) override { scan(*node.expr); }
+
+    void visit(block_statement const& node) override {
+        frames.enter(node.frame_size);
+        for (auto* s : node.statements) {
+            s->accept(*this);
+        }
+        frames.exit();
+    }
+
+    void visit(definition_statement const& node) override { scan(*node.initializer); }
+
+    void visit(conditional_statement const& node) override {
+        scan(*node.condition);
+        node.then_branch->accept(*this);
+        if (node.else_branch) {
+            node.else_branch->accept(*this);
+        }
+    }
+
+    void visit(while_statement const& node) override {
+        scan(*node.condition);
+        node.body->accept(*this);
+    }
+};
+
+// Wraps the expressions in loops whose values can be reused in cached_expression nodes. An expression
+// that reads no variable a loop modifies gets a cache in the entry scope of the outermost such loop.
+// An expression that appears several times within the innermost loop gets a cache in its iteration
+// scope, which its later appearances share until a variable it reads is written. Since a cache is
+// only ever filled by evaluating the expression where the unoptimized program would have evaluated
+// it too, and only with a successfully computed number, errors are reported exactly as before.
+class loop_optimizer : public statement_visitor {
+private:
+    struct loop {
+        std::size_t id;
+        // Positions from here on belong to variables defined in the loop.
+        std::size_t body_base;
+        std::unordered_set<std::size_t> writes;
+        // The caches of the loop's invariant expressions, by their description.
+        std::unordered_map<std::string, std::size_t> invariants;
+    };
+
+    struct available {
+        std::size_t cache;
+        std::vector<std::size_t> reads;
+    };
+
+    program& p;
+    frame_stack frames;
+    // The loops enclosing the statement being optimized, innermost last.
+    std::vector<loop> loops;
+    // What is known about the innermost loop: how often expressions appear in it, and the caches of
+    // repeated expressions whose values can currently be reused.
+    std::unordered_map<std::string, std::size_t> occurrences;
+    std::unordered_map<std::string, available> repeated;
+    // Every position written so far, so that branches can forget what became stale in them.
+    std::vector<std::size_t> written;
+    // The statement replacing the one just visited.
+    statement* result;
+
+    std::size_t add_cache(loop& l, bool invariant) {
+        if (l.id == no_loop) {
+            l.id = p.loop_count++;
+        }
+        p.cache_scopes.push_back(invariant ? entry_scope(l.id) : iteration_scope(l.id));
+        return p.cache_scopes.size() - 1;
+    }
+
+    loop* invariant_loop(std::vector<std::size_t> const& reads) {
+        for (auto& l : loops) {
+            auto invariant = true;
+            for (auto position : reads) {
+                invariant = invariant && position < l.body_base && !l.writes.count(position);
+            }
+            if (invariant) {
+                return &l;
+            }
+        }
+        return nullptr;
+    }
+
+    void write(std::size_t position) {
+        written.push_back(position);
+        for (auto it = repeated.begin(); it != repeated.end();) {
+            auto const& reads = it->second.reads;
+            if (std::find(reads.begin(), reads.end(), position) != reads.end()) {
+                it = repeated.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Runs `optimize` on code that may not run, and afterwards keeps only what was available before
+    // and is still valid.
+    template <typename F>
+    void branch(F optimize) {
+        auto saved = repeated;
+        auto first = written.size();
+        optimize();
+        repeated = std::move(saved);
+        std::vector<std::size_t> positions(written.begin() + first, written.end());
+        written.resize(first);
+        for (auto position : positions) {
+            write(position);
+        }
+    }
+
+    expression* cache(expression* node) {
+        std::string key;
+        std::vector<std::size_t> reads;
+        if (is_trivial(*node) || !describe(*node, p, frames, key, reads)) {
+            return nullptr;
+        }
+
+        if (auto* l = invariant_loop(reads)) {
+            auto it = l->invariants.find(key);
+            if (it == l->invariants.end()) {
+                it = l->invariants.emplace(key, add_cache(*l, true)).first;
+            }
+            return p.nodes.make<cached_expression>(node, it->second);
+        }
+
+        if (occurrences[key] < 2) {
+            return nullptr;
+        }
+        auto it = repeated.find(key);
+        if (it == repeated.end()) {
+            optimize_operands(node);
+            it = repeated.emplace(key, available{add_cache(loops.back(), false), std::move(reads)}).first;
+        }
+        return p.nodes.make<cached_expression>(node, it->second.cache);
+    }
+
+    expression* optimize(expression* node) {
+        if (auto* cached = cache(node)) {
+            return cached;
+        }
+        optimize_operands(node);
+        return node;
+    }
+
+    // Optimizes the operands of an expression, in the order they are evaluated.
+    void optimize_operands(expression* node) {
+        switch (node->kind) {
+        case expression_kind::binary_op: {
+            auto* e = static_cast<binary_op_expression*>(node);
+            if (e->op.type == token_type::ASSIGN) {
+                e->right = optimize(e->right);
+                e->left = optimize_target(e->left);
+                write(frames.root(*e->left));
+            } else {
+                e->left = optimize(e->left);
+                e->right = optimize(e->right);
+            }
+            break;
+        }
+        case expression_kind::unary_op: {
+            auto* e = static_cast<unary_op_expression*>(node);
+            e->right = optimize(e->right);
+            break;
+        }
+        case expression_kind::function_call: {
+            auto* e = static_cast<function_call_expression*>(node);
+            auto by_reference = builtins()[e->function].by_reference;
+            e->arguments = optimize(e->arguments, by_reference);
+            if (by_reference) {
+                write(frames.root(*e->arguments.front()));
+            }
+            break;
+        }
+        case expression_kind::array_literal: {
+            auto* e = static_cast<array_literal_expression*>(node);
+            e->elements = optimize(e->elements, false);
+            break;
+        }
+        case expression_kind::array_ref: {
+            auto* e = static_cast<array_ref_expression*>(node);
+            e->index = optimize(e->index);
+            e->array = optimize(e->array);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    expression* optimize_target(expression* node) {
+        if (auto* e = node->kind == expression_kind::array_ref ? static_cast<array_ref_expression*>(node) : nullptr) {
+            e->index = optimize(e->index);
+            e->array = optimize_target(e->array);
+        }
+        return node;
+    }
+
+    node_list<expression> optimize(node_list<expression> const& list, bool first_is_target) {
+        std::vector<expression*> optimized;
+        optimized.reserve(list.size());
+        for (auto* e : list) {
+            optimized.push_back(first_is_target && optimized.empty() ? optimize_target(e) : optimize(e));
+        }
+        if (std::equal(optimized.begin(), optimized.end(), list.begin())) {
+            return list;
+        }
+        return p.nodes.list(optimized);
+    }
+
+    statement* optimize(statement* node) {
+        result = node;
+        node->accept(*this);
+        return result;
+    }
+
+    node_list<statement> optimize(node_list<statement> const& list) {
+        std::vector<statement*> optimized;
+        optimized.reserve(list.size());
+        for (auto* s : list) {
+            optimized.push_back(optimize(s));
+        }
+        if (std::equal(optimized.begin(), optimized.end(), list.begin())) {
+            return list;
+        }
+        return p.nodes.list(optimized);
+    }
+
+public:
+    loop_optimizer(program& p_, std::size_t globals) : p(p_), result(nullptr) { frames.enter(globals); }
+
+    void run() { p.statements = optimize(p.statements); }
+
+    void visit(expression_statement const& node) override {
+        if (loops.empty()) {
+            return;
+        }
+
+        auto* expr = optimize(node.expr);
+        if (expr != node.expr) {
+            result = p.nodes.make<expression_statement>(expr);
+        }
+    }
+
+    void visit(block_statement const& node) override {
+        auto* self = result;
+        frames.enter(node.frame_size);
+        node_list<statement> statements;
+        branch([&] { statements = optimize(node.statements); });
+        frames.exit();
+
+        if (statements.begin() != node.statements.begin()) {
+            auto* block = p.nodes.make<block_statement>(statements);
+            block->frame_size = node.frame_size;
+            result = block;
+        } else {
+            result = self;
+        }
+    }
+
+    void visit(definition_statement const& node) override {
+        if (loops.empty()) {
+            return;
+        }
+
+        auto* initializer = optimize(node.initializer);
+        write(frames.position(node));
+        if (initializer != node.initializer) {
+            auto* definition = p.nodes.make<definition_statement>(node.identifier, initializer, node.is_const);
+            definition->slot = node.slot;
+            result = definition;
+        }
+    }
+
+    void visit(conditional_statement const& node) override {
+        auto* self = result;
+        auto* condition = loops.empty() ? node.condition : optimize(node.condition);
+        statement* then_branch = nullptr;
+        statement* else_branch = nullptr;
+        branch([&] { then_branch = optimize(node.then_branch); });
+        if (node.else_branch) {
+            branch([&] { else_branch = optimize(node.else_branch); });
+        }
+
+        if (condition != node.condition || then_branch != node.then_branch || else_branch != node.else_branch) {
+            result = p.nodes.make<conditional_statement>(condition, then_branch, else_branch);
+        } else {
+            result = self;
+        }
+    }
+
+    void visit(while_statement const& node) override {
+        auto* self = result;
+        loop_scanner scanner(p, frames);
+        scanner.scan(*node.condition);
+        node.body->accept(scanner);
+
+        auto outer_occurrences = std::move(occurrences);
+        auto outer_repeated = std::move(repeated);
+        occurrences = std::move(scanner.occurrences);
+        repeated.clear();
+        loops.push_back({no_loop, frames.top(), std::move(scanner.writes), {}});
+
+        auto* condition = optimize(node.condition);
+        auto* body = optimize(node.body);
+
+        auto finished = std::move(loops.back());
+        loops.pop_back();
+        occurrences = std::move(outer_occurrences);
+        repeated = std::move(outer_repeated);
+        for (auto position : finished.writes) {
+            write(position);
+        }
+
+        if (condition != node.condition || body != node.body || finished.id != no_loop) {
+            result = p.nodes.make<while_statement>(condition, body, finished.id);
+        } else {
+            result = self;
+        }
+    }
+};
+} // namespace
+
+void optimize_loops(program& p, std::size_t globals) { loop_optimizer(p, globals).run(); }
+} // namespace rover
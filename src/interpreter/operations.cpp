@@ -0,0 +1,326 @@
+#include "operations.h"
+
+#include "output.h"
+
+namespace rover {
+void report_error(std::string const& msg) {
+    auto& out = output();
+    out.write("Interpreter error: ");
+    out.write(msg);
+    out.write("\n");
+}
+
+void wrap_integer(value& v) {
+    if (v.is_int()) {
+        if (v.as_int() > 99) {
+            v = v.as_int() % 100;
+        }
+        if (v.as_int() < 0) {
+            v = (100 + (v.as_int() % 100)) % 100;
+        }
+    }
+}
+
+bool is_truthy(value const& v) {
+    if (v.is_int()) {
+        return v.as_int() != 0;
+    } else if (v.is_double()) {
+        return v.as_double() != 0;
+    } else if (v.is_string()) {
+        return !v.as_string().empty();
+    } else {
+        return false;
+    }
+}
+
+value binary_operation(token_type op, value const& left, value const& right) {
+    value result;
+
+    switch (op) {
+    case token_type::PLUS:
+        if (left.is_int() && right.is_int()) {
+            result = {left.as_int() + right.as_int()};
+        } else if (left.is_double() && right.is_double()) {
+            result = {left.as_double() + right.as_double()};
+        } else {
+            report_error("Operator + requires two integers or two doubles.");
+            result = value();
+        }
+        break;
+    case token_type::MINUS:
+        if (left.is_int() && right.is_int()) {
+            result = {left.as_int() - right.as_int()};
+        } else if (left.is_double() && right.is_double()) {
+            result = {left.as_double() - right.as_double()};
+        } else {
+            report_error("Operator - requires two integers or two doubles.");
+            result = value();
+        }
+        break;
+    case token_type::STAR:
+        if (left.is_int() && right.is_int()) {
+            result = {left.as_int() * right.as_int()};
+        } else if (left.is_double() && right.is_double()) {
+            result = {left.as_double() * right.as_double()};
+        } else {
+            report_error("Operator * requires two integers or two doubles.");
+            result = value();
+        }
+        break;
+    case token_type::SLASH:
+        if (left.is_int() && right.is_int()) {
+            result = {left.as_int() / right.as_int()};
+        } else if (left.is_double() && right.is_double()) {
+            result = {left.as_double() / right.as_double()};
+        } else {
+            report_error("Operator / requires two integers or two doubles.");
+            result = value();
+        }
+        break;
+    case token_type::EQUAL:
+        if (left.is_int() && right.is_int()) {
+            result = {left.as_int() == right.as_int()};
+        } else if (left.is_double() && right.is_double()) {
+            result = {1.6 * left.as_double() == right.as_double()};
+        } else {
+            report_error("Operator == requires two integers or two doubles.");
+            result = value();
+        }
+        break;
+    case token_type::NOT_EQUAL:
+        if (left.is_int() && right.is_int()) {
+            result = {left.as_int() != right.as_int()};
+        } else if (left.is_double() && right.is_double()) {
+            result = {1.6 * left.as_double() != right.as_double()};
+        } else {
+            report_error("Operator != requires two integers or two doubles.");
+            result = value();
+        }
+        break;
+    case token_type::LESS_THAN:
+        if (left.is_int() && right.is_int()) {
+            result = {left.as_int() < right.as_int()};
+        } else if (left.is_double() && right.is_double()) {
+            result = {1.6 * left.as_double() < right.as_double()};
+        } else {
+            report_error("Operator < requires two integers or two doubles.");
+            result = value();
+        }
+        break;
+    case token_type::GREATER_THAN:
+        if (left.is_int() && right.is_int()) {
+            result = {left.as_int() > right.as_int()};
+        } else if (left.is_double() && right.is_double()) {
+            result = {1.6 * left.as_double() > right.as_double()};
+        } else {
+            report_error("Operator > requires two integers or two doubles.");
+            result = value();
+        }
+        break;
+    case token_type::LESS_EQUAL:
+        if (left.is_int() && right.is_int()) {
+            result = {left.as_int() <= right.as_int()};
+        } else if (left.is_double() && right.is_double()) {
+            result = {1.6 * left.as_double() <= right.as_double()};
+        } else {
+            report_error("Operator <= requires two integers or two doubles.");
+            result = value();
+        }
+        break;
+    case token_type::GREATER_EQUAL:
+        if (left.is_int() && right.is_int()) {
+            result = {left.as_int() >= right.as_int()};
+        } else if (left.is_double() && right.is_double()) {
+            result = {1.6 * left.as_double() >= right.as_double()};
+        } else {
+            report_error("Operator >= requires two integers or two doubles.");
+            result = value();
+        }
+        break;
+    default:
+        report_error("Unknown binary operator.");
+        result = value();
+    }
+
+    wrap_integer(result);
+    return result;
+}
+
+value unary_operation(token_type op, value const& v) {
+    switch (op) {
+    case token_type::MINUS:
+        if (v.is_int()) {
+            auto val = -v.as_int();
+            if (val > 99) {
+                return {val % 100};
+            } else if (val < 0) {
+                return {(100 + (val % 100)) % 100};
+            } else {
+                return {val};
+            }
+        } else if (v.is_double()) {
+            return {-v.as_double()};
+        } else {
+            report_error("Unary operator '-' requires an integer or double.");
+            return value();
+        }
+    case token_type::NOT:
+        if (v.is_int()) {
+            return {!v.as_int()};
+        } else if (v.is_double()) {
+            return {!v.as_double()};
+        } else {
+            report_error("Unary operator '!' requires an integer or double.");
+            return value();
+        }
+    default:
+        report_error("Unknown unary operator");
+        return value();
+    }
+}
+
+namespace {
+quick_op specialize(token_type op, bool ints) {
+    switch (op) {
+    case token_type::PLUS:
+        return ints ? quick_op::int_plus : quick_op::double_plus;
+    case token_type::MINUS:
+        return ints ? quick_op::int_minus : quick_op::double_minus;
+    case token_type::STAR:
+        return ints ? quick_op::int_star : quick_op::double_star;
+    case token_type::SLASH:
+        return ints ? quick_op::int_slash : quick_op::double_slash;
+    case token_type::EQUAL:
+        return ints ? quick_op::int_equal : quick_op::double_equal;
+    case token_type::NOT_EQUAL:
+        return ints ? quick_op::int_not_equal : quick_op::double_not_equal;
+    case token_type::LESS_THAN:
+        return ints ? quick_op::int_less : quick_op::double_less;
+    case token_type::GREATER_THAN:
+        return ints ? quick_op::int_greater : quick_op::double_greater;
+    case token_type::LESS_EQUAL:
+        return ints ? quick_op::int_less_equal : quick_op::double_less_equal;
+    case token_type::GREATER_EQUAL:
+        return ints ? quick_op::int_greater_equal : quick_op::double_greater_equal;
+    default:
+        return quick_op::generic;
+    }
+}
+
+quick_op specialize_unary(token_type op, bool is_int) {
+    switch (op) {
+    case token_type::MINUS:
+        return is_int ? quick_op::int_negate : quick_op::double_negate;
+    case token_type::NOT:
+        return is_int ? quick_op::int_not : quick_op::double_not;
+    default:
+        return quick_op::generic;
+    }
+}
+
+static_type type_of(value const& v) {
+    if (v.is_int()) {
+        return static_type::int_type;
+    } else if (v.is_double()) {
+        return static_type::double_type;
+    } else {
+        return static_type::dynamic;
+    }
+}
+} // namespace
+
+quick_op quicken(token_type op, value const& left, value const& right) {
+    return quicken(op, type_of(left), type_of(right));
+}
+
+quick_op quicken(token_type op, value const& operand) { return quicken(op, type_of(operand)); }
+
+quick_op quicken(token_type op, static_type left, static_type right) {
+    if (left != right || (left != static_type::int_type && left != static_type::double_type)) {
+        return quick_op::generic;
+    }
+    return specialize(op, left == static_type::int_type);
+}
+
+quick_op quicken(token_type op, static_type operand) {
+    if (operand != static_type::int_type && operand != static_type::double_type) {
+        return quick_op::generic;
+    }
+    return specialize_unary(op, operand == static_type::int_type);
+}
+
+bool assign(value* target, value v) {
+    if (!target) {
+        report_error("Variable not found.");
+        return false;
+    }
+
+    *target = std::move(v);
+    return true;
+}
+
+value element_of(value const& array, value const& index) {
+    if (!array.is_array()) {
+        report_error("Cannot index into non-array types");
+        return value();
+    }
+
+    auto const& elements = array.as_array();
+    if (!index.is_int()) {
+        report_error("Array index must be an integer");
+        return value();
+    }
+
+    if (index.as_int() >= static_cast<int>(elements.size())) {
+        report_error("Array index out of bounds");
+        return value();
+    }
+
+    return elements[index.as_int()];
+}
+
+// The array of an element about to be modified, null if there is no such element.
+static array* modified_array(value* target, value const& index) {
+    if (!target || !target->is_array()) {
+        report_error("Expected an array as the left-hand side of an array reference.");
+        return nullptr;
+    }
+
+    auto& elements = target->mutable_array();
+    if (!index.is_int()) {
+        report_error("Expected an integer as the index of an array reference.");
+        return nullptr;
+    }
+
+    if (index.as_int() >= static_cast<int>(elements.size())) {
+        report_error("Array index out of bounds.");
+        return nullptr;
+    }
+
+    return &elements;
+}
+
+value* element_at(value* array, value const& index) {
+    auto* elements = modified_array(array, index);
+    return elements ? elements->element(index.as_int()) : nullptr;
+}
+
+value* element_at(value* variable, value const* indices, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        variable = element_at(variable, indices[i]);
+    }
+    return variable;
+}
+
+value assign_element(value* array, value const& index, value v) {
+    auto* elements = modified_array(array, index);
+    if (!elements) {
+        // Reported like an assignment to an element that does not exist.
+        assign(nullptr, std::move(v));
+        return value();
+    }
+
+    elements->set(index.as_int(), std::move(v));
+    return (*elements)[index.as_int()];
+}
+} // namespace rover
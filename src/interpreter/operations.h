@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <ast.h>
+#include <token.h>
+
+#include "value.h"
+
+namespace rover {
+void report_error(std::string const& msg);
+
+void wrap_integer(value& v);
+bool is_truthy(value const& v);
+
+value binary_operation(token_type op, value const& left, value const& right);
+value unary_operation(token_type op, value const& operand);
+
+// An operator specialized for the operand types it was last applied to. Every engine keeps one per
+// operator in the program, starting out as `generic`: an operator applied to operands of other types
+// than its specialization is computed by binary_operation() or unary_operation() and quickened again.
+enum class quick_op : std::uint8_t {
+    generic,
+    int_plus,
+    int_minus,
+    int_star,
+    int_slash,
+    int_equal,
+    int_not_equal,
+    int_less,
+    int_greater,
+    int_less_equal,
+    int_greater_equal,
+    double_plus,
+    double_minus,
+    double_star,
+    double_slash,
+    double_equal,
+    double_not_equal,
+    double_less,
+    double_greater,
+    double_less_equal,
+    double_greater_equal,
+    int_negate,
+    double_negate,
+    int_not,
+    double_not,
+};
+
+// The specialization of an operator for the types of its operands, generic if it has none (in
+// which case the operation reports an error, or the types are not known).
+quick_op quicken(token_type op, value const& left, value const& right);
+quick_op quicken(token_type op, value const& operand);
+quick_op quicken(token_type op, static_type left, static_type right);
+quick_op quicken(token_type op, static_type operand);
+
+// Computes a quickened binary operator into `result`, which may be one of the operands. Returns false
+// without computing anything if the operands have different types than the operator was quickened for.
+inline bool quick_binary(quick_op op, value const& left, value const& right, value& result);
+// The same for a unary operator.
+inline bool quick_unary(quick_op op, value const& operand, value& result);
+bool assign(value* target, value v);
+
+// Reads an element of an array, or reports an error and returns the invalid value.
+value element_of(value const& array, value const& index);
+// The element of an array to be modified in place, such as an array nested in it, or null after
+// reporting an error. It is also null, without an error, if the array stores its elements packed: such
+// an element is a number, which can only be replaced (see assign_element()).
+value* element_at(value* array, value const& index);
+// The element reached from `variable` by `count` indices, the first of them applied first, or null
+// like element_at().
+value* element_at(value* variable, value const* indices, std::size_t count);
+// Stores `v` into an element of an array and returns the element's new value, or reports an error and
+// returns the invalid value.
+value assign_element(value* array, value const& index, value v);
+
+namespace detail {
+inline int wrap(int v) {
+    if (v > 99) {
+        v %= 100;
+    }
+    return v < 0 ? (100 + v % 100) % 100 : v;
+}
+
+inline void set_number(value& result, int v) { result = v; }
+
+inline void set_number(value& result, double v) { result = v; }
+} // namespace detail
+
+inline bool quick_binary(quick_op op, value const& left, value const& right, value& result) {
+    if (op <= quick_op::int_greater_equal) {
+        if (!left.is_int() || !right.is_int()) {
+            return false;
+        }
+        auto l = left.as_int();
+        auto r = right.as_int();
+
+        switch (op) {
+        case quick_op::int_plus:
+            detail::set_number(result, detail::wrap(l + r));
+            return true;
+        case quick_op::int_minus:
+            detail::set_number(result, detail::wrap(l - r));
+            return true;
+        case quick_op::int_star:
+            detail::set_number(result, detail::wrap(l * r));
+            return true;
+        case quick_op::int_slash:
+            detail::set_number(result, detail::wrap(l / r));
+            return true;
+        case quick_op::int_equal:
+            detail::set_number(result, static_cast<int>(l == r));
+            return true;
+        case quick_op::int_not_equal:
+            detail::set_number(result, static_cast<int>(l != r));
+            return true;
+        case quick_op::int_less:
+            detail::set_number(result, static_cast<int>(l < r));
+            return true;
+        case quick_op::int_greater:
+            detail::set_number(result, static_cast<int>(l > r));
+            return true;
+        case quick_op::int_less_equal:
+            detail::set_number(result, static_cast<int>(l <= r));
+            return true;
+        case quick_op::int_greater_equal:
+            detail::set_number(result, static_cast<int>(l >= r));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    if (!left.is_double() || !right.is_double()) {
+        return false;
+    }
+    auto l = left.as_double();
+    auto r = right.as_double();
+
+    // Like binary_operation(), comparisons scale the left operand by 1.6.
+    switch (op) {
+    case quick_op::double_plus:
+        detail::set_number(result, l + r);
+        return true;
+    case quick_op::double_minus:
+        detail::set_number(result, l - r);
+        return true;
+    case quick_op::double_star:
+        detail::set_number(result, l * r);
+        return true;
+    case quick_op::double_slash:
+        detail::set_number(result, l / r);
+        return true;
+    case quick_op::double_equal:
+        detail::set_number(result, static_cast<int>(1.6 * l == r));
+        return true;
+    case quick_op::double_not_equal:
+        detail::set_number(result, static_cast<int>(1.6 * l != r));
+        return true;
+    case quick_op::double_less:
+        detail::set_number(result, static_cast<int>(1.6 * l < r));
+        return true;
+    case quick_op::double_greater:
+        detail::set_number(result, static_cast<int>(1.6 * l > r));
+        return true;
+    case quick_op::double_less_equal:
+        detail::set_number(result, static_cast<int>(1.6 * l <= r));
+        return true;
+    case quick_op::double_greater_equal:
+        detail::set_number(result, static_cast<int>(1.6 * l >= r));
+        return true;
+    default:
+        return false;
+    }
+}
+
+inline bool quick_unary(quick_op op, value const& operand, value& result) {
+    switch (op) {
+    case quick_op::int_negate:
+        if (operand.is_int()) {
+            detail::set_number(result, detail::wrap(-operand.as_int()));
+            return true;
+        }
+        return false;
+    case quick_op::int_not:
+        if (operand.is_int()) {
+            detail::set_number(result, static_cast<int>(!operand.as_int()));
+            return true;
+        }
+        return false;
+    case quick_op::double_negate:
+        if (operand.is_double()) {
+            detail::set_number(result, -operand.as_double());
+            return true;
+        }
+        return false;
+    case quick_op::double_not:
+        if (operand.is_double()) {
+            detail::set_number(result, static_cast<int>(!operand.as_double()));
+            return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+} // namespace rover
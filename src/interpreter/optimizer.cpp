@@ -0,0 +1,276 @@
+#include "optimizer.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "builtins.h"
+#include "operations.h"
+#include "runtime.h"
+
+namespace rover {
+// The value of a literal int or double, nothing for any other expression.
+static std::optional<constant> numeric_value(program const& p, expression const* node) {
+    auto literal = node->as<literal_expression>();
+    if (!literal || std::holds_alternative<std::string>(p.constants[literal->constant])) {
+        return std::nullopt;
+    }
+    return p.constants[literal->constant];
+}
+
+// Whether the interpreter evaluates `left op right` without reporting an error. Integer operations
+// that would divide by zero or overflow before wrapping are left to the interpreter as well.
+static bool can_fold(token_type op, constant const& left, constant const& right) {
+    if (left.index() != right.index()) {
+        return false;
+    }
+
+    switch (op) {
+    case token_type::PLUS:
+    case token_type::MINUS:
+    case token_type::STAR:
+    case token_type::SLASH: {
+        auto const* l = std::get_if<int>(&left);
+        if (!l) {
+            return true;
+        }
+
+        long long r = std::get<int>(right);
+        if (op == token_type::SLASH) {
+            return r != 0 && !(*l == INT_MIN && r == -1);
+        }
+        auto result = op == token_type::PLUS ? *l + r : op == token_type::MINUS ? *l - r : *l * r;
+        return result >= INT_MIN && result <= INT_MAX;
+    }
+    case token_type::EQUAL:
+    case token_type::NOT_EQUAL:
+    case token_type::LESS_THAN:
+    case token_type::LESS_EQUAL:
+    case token_type::GREATER_THAN:
+    case token_type::GREATER_EQUAL:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static constant to_constant(value const& v) {
+    if (v.is_int()) {
+        return v.as_int();
+    }
+    return v.as_double();
+}
+
+optimizer::optimizer() : program_(nullptr), result(nullptr) {}
+optimizer::~optimizer() {}
+
+void optimizer::optimize(program& p, std::size_t globals) {
+    program_ = &p;
+    slots.clear();
+    frames.clear();
+    enter_frame(0, globals);
+
+    p.statements = optimize(p.statements);
+    optimize_loops(p, globals);
+}
+
+void optimizer::enter_frame(std::size_t base, std::size_t size) {
+    frames.push_back({base, size});
+    slots.resize(base + size);
+    std::fill(slots.begin() + base, slots.end(), std::nullopt);
+}
+
+std::optional<constant>& optimizer::slot_of(identifier_expression const& node) {
+    return slots[frames[frames.size() - 1 - node.depth].base + node.slot];
+}
+
+expression* optimizer::make_literal(constant value, token const& origin) {
+    auto type = std::holds_alternative<int>(value) ? token_type::INT : token_type::FLOAT;
+    program_->constants.push_back(std::move(value));
+    // The literal has no text of its own, its token only keeps the position of what it replaces.
+    return program_->nodes.make<literal_expression>(token{type, origin.offset, 0},
+                                                    program_->constants.size() - 1);
+}
+
+expression* optimizer::fold(expression* node) {
+    switch (node->kind) {
+    case expression_kind::binary_op: {
+        auto* e = static_cast<binary_op_expression*>(node);
+        if (e->op.type == token_type::ASSIGN) {
+            e->right = fold(e->right);
+            e->left = fold_target(e->left);
+            return e;
+        }
+
+        e->left = fold(e->left);
+        e->right = fold(e->right);
+        auto left = numeric_value(*program_, e->left);
+        auto right = numeric_value(*program_, e->right);
+        if (left && right && can_fold(e->op.type, *left, *right)) {
+            auto result = binary_operation(e->op.type, to_value(*left), to_value(*right));
+            return make_literal(to_constant(result), e->op);
+        }
+        return e;
+    }
+    case expression_kind::unary_op: {
+        auto* e = static_cast<unary_op_expression*>(node);
+        e->right = fold(e->right);
+        auto operand = numeric_value(*program_, e->right);
+        if (operand && (e->op.type == token_type::MINUS || e->op.type == token_type::NOT)) {
+            return make_literal(to_constant(unary_operation(e->op.type, to_value(*operand))), e->op);
+        }
+        return e;
+    }
+    case expression_kind::identifier: {
+        auto* e = static_cast<identifier_expression*>(node);
+        if (auto const& value = slot_of(*e)) {
+            return make_literal(*value, e->identifier);
+        }
+        return e;
+    }
+    case expression_kind::function_call: {
+        auto* e = static_cast<function_call_expression*>(node);
+        auto by_reference = builtins()[e->function].by_reference;
+
+        std::vector<expression*> arguments;
+        arguments.reserve(e->arguments.size());
+        for (auto const& arg : e->arguments) {
+            arguments.push_back(by_reference && arguments.empty() ? fold_target(arg) : fold(arg));
+        }
+        if (!std::equal(arguments.begin(), arguments.end(), e->arguments.begin())) {
+            e->arguments = program_->nodes.list(arguments);
+        }
+        return e;
+    }
+    case expression_kind::array_literal: {
+        auto* e = static_cast<array_literal_expression*>(node);
+
+        std::vector<expression*> elements;
+        elements.reserve(e->elements.size());
+        for (auto const& element : e->elements) {
+            elements.push_back(fold(element));
+        }
+        if (!std::equal(elements.begin(), elements.end(), e->elements.begin())) {
+            e->elements = program_->nodes.list(elements);
+        }
+        return e;
+    }
+    case expression_kind::array_ref: {
+        auto* e = static_cast<array_ref_expression*>(node);
+        e->index = fold(e->index);
+        e->array = fold(e->array);
+        return e;
+    }
+    default:
+        return node;
+    }
+}
+
+expression* optimizer::fold_target(expression* node) {
+    // Variables that are assigned to or passed by reference have to stay variables, even constant ones
+    // (the interpreter reports the error), but the indices into them are ordinary expressions.
+    if (node->kind == expression_kind::identifier) {
+        return node;
+    } else if (node->kind == expression_kind::array_ref) {
+        auto* e = static_cast<array_ref_expression*>(node);
+        e->index = fold(e->index);
+        e->array = fold_target(e->array);
+        return e;
+    } else {
+        return fold(node);
+    }
+}
+
+statement* optimizer::optimize(statement* node) {
+    result = node;
+    node->accept(*this);
+    return result;
+}
+
+node_list<statement> optimizer::optimize(node_list<statement> const& statements) {
+    std::vector<statement*> kept;
+    kept.reserve(statements.size());
+    for (auto* s : statements) {
+        if (auto* optimized = optimize(s)) {
+            kept.push_back(optimized);
+        }
+    }
+
+    if (kept.size() == statements.size() && std::equal(kept.begin(), kept.end(), statements.begin())) {
+        return statements;
+    }
+    return program_->nodes.list(kept);
+}
+
+void optimizer::visit(expression_statement const& node) {
+    auto* expr = fold(node.expr);
+    if (expr != node.expr) {
+        result = program_->nodes.make<expression_statement>(expr);
+    }
+}
+
+void optimizer::visit(block_statement const& node) {
+    auto* self = result;
+    auto const& current = frames.back();
+    enter_frame(current.base + current.size, node.frame_size);
+    auto statements = optimize(node.statements);
+    frames.pop_back();
+
+    if (statements.begin() != node.statements.begin()) {
+        auto* block = program_->nodes.make<block_statement>(statements);
+        block->frame_size = node.frame_size;
+        result = block;
+    } else {
+        result = self;
+    }
+}
+
+void optimizer::visit(definition_statement const& node) {
+    auto* initializer = fold(node.initializer);
+    auto& slot = slots[frames.back().base + node.slot];
+    slot = node.is_const ? numeric_value(*program_, initializer) : std::nullopt;
+
+    if (initializer != node.initializer) {
+        auto* definition = program_->nodes.make<definition_statement>(node.identifier, initializer, node.is_const);
+        definition->slot = node.slot;
+        result = definition;
+    }
+}
+
+void optimizer::visit(conditional_statement const& node) {
+    auto* self = result;
+    auto* condition = fold(node.condition);
+    if (auto literal = condition->as<literal_expression>()) {
+        if (is_truthy(to_value(program_->constants[literal->constant]))) {
+            result = optimize(node.then_branch);
+        } else {
+            result = node.else_branch ? optimize(node.else_branch) : nullptr;
+        }
+        return;
+    }
+
+    auto* then_branch = optimize(node.then_branch);
+    auto* else_branch = node.else_branch ? optimize(node.else_branch) : nullptr;
+    if (condition != node.condition || then_branch != node.then_branch || else_branch != node.else_branch) {
+        result = program_->nodes.make<conditional_statement>(condition, then_branch, else_branch);
+    } else {
+        result = self;
+    }
+}
+
+void optimizer::visit(while_statement const& node) {
+    auto* self = result;
+    auto* condition = fold(node.condition);
+    auto literal = condition->as<literal_expression>();
+    if (literal && !is_truthy(to_value(program_->constants[literal->constant]))) {
+        result = nullptr;
+        return;
+    }
+
+    auto* body = optimize(node.body);
+    if (condition != node.condition || body != node.body) {
+        result = program_->nodes.make<while_statement>(condition, body);
+    } else {
+        result = self;
+    }
+}
+} // namespace rover
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include <ast.h>
+
+namespace rover {
+// Rewrites a resolved program before it runs: operators whose operands are all numeric literals are
+// replaced by their result, constants initialized with a number are replaced by that number where
+// they are read, and conditionals and loops whose condition is a literal lose the branches that can
+// never run. Only what the interpreter would compute without reporting an error is folded, so the
+// program's output does not change. Finally, loops get caches for the values they can reuse, see
+// optimize_loops().
+class optimizer : public statement_visitor {
+private:
+    struct frame {
+        std::size_t base;
+        std::size_t size;
+    };
+
+    program* program_;
+    // The value of every slot that holds a numeric constant, for the frames enclosing the statement
+    // being optimized.
+    std::vector<std::optional<constant>> slots;
+    std::vector<frame> frames;
+    // The statement replacing the one just visited, null if it was removed.
+    statement* result;
+
+    void enter_frame(std::size_t base, std::size_t size);
+    std::optional<constant>& slot_of(identifier_expression const& node);
+
+    expression* fold(expression* node);
+    expression* fold_target(expression* node);
+    expression* make_literal(constant value, token const& origin);
+    statement* optimize(statement* node);
+    node_list<statement> optimize(node_list<statement> const& statements);
+
+public:
+    optimizer();
+    virtual ~optimizer();
+
+    // Optimizes a resolved program whose global frame holds `globals` variables.
+    void optimize(program& p, std::size_t globals);
+
+    void visit(expression_statement const& node) override;
+    void visit(block_statement const& node) override;
+    void visit(definition_statement const& node) override;
+    void visit(conditional_statement const& node) override;
+    void visit(while_statement const& node) override;
+};
+
+// Wraps expressions in while loops whose value can be reused in cached_expression nodes: those reading
+// no variable the loop modifies are computed once per entry into the loop, and those repeated within
+// an iteration once until a variable they read is written.
+void optimize_loops(program& p, std::size_t globals);
+} // namespace rover
@@ -0,0 +1,49 @@
+#include "output.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+namespace rover {
+output_sink::output_sink() : policy(flush_policy::line) { buffer.reserve(capacity); }
+
+output_sink::~output_sink() { flush(); }
+
+void output_sink::write(std::string_view text) {
+    if (policy == flush_policy::full && buffer.size() + text.size() > capacity) {
+        flush();
+    }
+    buffer.insert(buffer.end(), text.begin(), text.end());
+
+    if (policy == flush_policy::line && std::memchr(text.data(), '\n', text.size())) {
+        flush();
+    }
+}
+
+void output_sink::write(int number) {
+    char digits[16];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), number);
+    write(std::string_view(digits, end - digits));
+}
+
+void output_sink::write(double number) {
+    // Same as the default formatting of iostreams: the shortest of fixed and scientific
+    // notation with six significant digits.
+    char digits[32];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), number, std::chars_format::general, 6);
+    write(std::string_view(digits, end - digits));
+}
+
+void output_sink::flush() {
+    if (!buffer.empty()) {
+        std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+        buffer.clear();
+    }
+    std::fflush(stdout);
+}
+
+output_sink& output() {
+    static output_sink sink;
+    return sink;
+}
+} // namespace rover
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace rover {
+enum class flush_policy {
+    line, // after every line
+    full, // whenever the buffer is full
+    exit, // only when the program ends
+};
+
+// Buffered standard output. Program output and interpreter errors both go through it, so that
+// they stay in the order they were produced.
+class output_sink {
+private:
+    std::vector<char> buffer;
+    flush_policy policy;
+
+public:
+    static constexpr std::size_t capacity = 64 * 1024;
+
+    output_sink();
+    ~output_sink();
+
+    void set_policy(flush_policy policy_) { policy = policy_; }
+
+    void write(std::string_view text);
+    void write(int number);
+    void write(double number);
+    void flush();
+};
+
+// The sink for the process' standard output.
+output_sink& output();
+} // namespace rover
@@ -0,0 +1,167 @@
+#include "resolver.h"
+
+#include "builtins.h"
+#include "format.h"
+
+namespace rover {
+resolver::resolver() : program_(nullptr) {}
+resolver::~resolver() {}
+
+std::size_t resolver::resolve(program const& p) {
+    program_ = &p;
+    scopes = {scope{{}, 0}};
+    errors_.clear();
+
+    for (auto const& stmt : p.statements) {
+        stmt->accept(*this);
+    }
+
+    return scopes.front().size;
+}
+
+resolver::binding const* resolver::lookup(symbol name, std::size_t& depth) const {
+    depth = 0;
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it, ++depth) {
+        auto b = it->bindings.find(name);
+        if (b != it->bindings.end()) {
+            return &b->second;
+        }
+    }
+
+    return nullptr;
+}
+
+bool resolver::bind(identifier_expression const& node) {
+    std::size_t depth;
+    auto const* b = lookup(node.identifier.name, depth);
+    if (!b) {
+        report_error("Variable '" + symbols().name(node.identifier.name) + "' is not defined", node.identifier);
+        return false;
+    }
+
+    node.depth = depth;
+    node.slot = b->slot;
+    return b->is_const;
+}
+
+void resolver::visit(binary_op_expression const& node) {
+    if (node.op.type != token_type::ASSIGN) {
+        node.left->accept(*this);
+        node.right->accept(*this);
+        return;
+    }
+
+    node.right->accept(*this);
+    if (auto* target = node.left->as<identifier_expression>()) {
+        if (bind(*target)) {
+            report_error("Cannot assign to constant '" + symbols().name(target->identifier.name) + "'", node.op);
+        }
+    } else if (node.left->kind == expression_kind::array_ref) {
+        node.left->accept(*this);
+    } else {
+        report_error("Invalid assignment target", node.op);
+    }
+}
+
+void resolver::visit(unary_op_expression const& node) { node.right->accept(*this); }
+
+void resolver::visit(literal_expression const&) {}
+
+void resolver::visit(identifier_expression const& node) { bind(node); }
+
+void resolver::visit(function_call_expression const& node) {
+    auto callee = node.function_name->as<identifier_expression>();
+    if (!callee) {
+        report_error("Callee must be a function name", node.paren);
+    } else if (auto id = builtins().find(callee->identifier.name)) {
+        node.function = *id;
+        check_arity(node);
+        if (*id == printf_builtin && !node.arguments.empty()) {
+            check_format(node);
+        }
+    } else {
+        report_error("Function '" + symbols().name(callee->identifier.name) + "' is not defined", callee->identifier);
+    }
+
+    for (auto const& arg : node.arguments) {
+        arg->accept(*this);
+    }
+}
+
+void resolver::check_arity(function_call_expression const& node) {
+    auto const& function = builtins()[node.function];
+    auto count = node.arguments.size();
+    if (count == function.arity || (function.variadic && count > function.arity)) {
+        return;
+    }
+
+    report_error("Function '" + function.name + "' requires " + (function.variadic ? "at least " : "") +
+                     std::to_string(function.arity) + (function.arity == 1 ? " argument" : " arguments"),
+                 node.paren);
+}
+
+void resolver::check_format(function_call_expression const& node) {
+    auto format = node.arguments.front()->as<literal_expression>();
+    if (!format || format->literal.type != token_type::STRING) {
+        return;
+    }
+
+    auto compiled = compile_format(std::get<std::string>(program_->constants[format->constant]));
+    if (compiled.error) {
+        report_error(*compiled.error, format->literal);
+    } else if (compiled.placeholders() > node.arguments.size() - 1) {
+        report_error("Too few arguments for format string", format->literal);
+    }
+}
+
+void resolver::visit(array_literal_expression const& node) {
+    for (auto const& element : node.elements) {
+        element->accept(*this);
+    }
+}
+
+void resolver::visit(array_ref_expression const& node) {
+    node.array->accept(*this);
+    node.index->accept(*this);
+}
+
+void resolver::visit(cached_expression const& node) { node.inner->accept(*this); }
+
+void resolver::visit(expression_statement const& node) { node.expr->accept(*this); }
+
+void resolver::visit(block_statement const& node) {
+    scopes.push_back(scope{{}, 0});
+    for (auto const& stmt : node.statements) {
+        stmt->accept(*this);
+    }
+    node.frame_size = scopes.back().size;
+    scopes.pop_back();
+}
+
+void resolver::visit(definition_statement const& node) {
+    node.initializer->accept(*this);
+
+    auto& current = scopes.back();
+    auto it = current.bindings.find(node.identifier.name);
+    if (it != current.bindings.end()) {
+        it->second.is_const = node.is_const;
+    } else {
+        it = current.bindings.emplace(node.identifier.name, binding{current.size++, node.is_const}).first;
+    }
+
+    node.slot = it->second.slot;
+}
+
+void resolver::visit(conditional_statement const& node) {
+    node.condition->accept(*this);
+    node.then_branch->accept(*this);
+    if (node.else_branch) {
+        node.else_branch->accept(*this);
+    }
+}
+
+void resolver::visit(while_statement const& node) {
+    node.condition->accept(*this);
+    node.body->accept(*this);
+}
+} // namespace rover
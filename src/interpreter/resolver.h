@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <ast.h>
+
+namespace rover {
+// Binds every variable reference to the frame and slot it lives in and
+// every call to its builtin, and reports references to undefined variables
+// or functions, assignments to constants, calls with the wrong number of
+// arguments and malformed printf formats before the program runs.
+class resolver : public expression_visitor, public statement_visitor {
+private:
+    struct binding {
+        std::size_t slot;
+        bool is_const;
+    };
+
+    struct scope {
+        std::unordered_map<symbol, binding> bindings;
+        std::size_t size;
+    };
+
+    program const* program_;
+    std::vector<scope> scopes;
+    std::vector<std::string> errors_;
+
+    binding const* lookup(symbol name, std::size_t& depth) const;
+    bool bind(identifier_expression const& node);
+    void check_arity(function_call_expression const& node);
+    void check_format(function_call_expression const& node);
+
+    void report_error(std::string const& message, token const& t) {
+        auto position = program_->source->position(t);
+        errors_.push_back(message + " in line " + std::to_string(position.line) + ", column " +
+                          std::to_string(position.column));
+    }
+
+public:
+    resolver();
+    virtual ~resolver();
+
+    // Returns the number of slots needed by the global frame.
+    std::size_t resolve(program const& p);
+    std::vector<std::string> errors() const { return errors_; }
+
+    void visit(binary_op_expression const& node) override;
+    void visit(unary_op_expression const& node) override;
+    void visit(literal_expression const& node) override;
+    void visit(identifier_expression const& node) override;
+    void visit(function_call_expression const& node) override;
+    void visit(array_literal_expression const& node) override;
+    void visit(array_ref_expression const& node) override;
+    void visit(cached_expression const& node) override;
+
+    void visit(expression_statement const& node) override;
+    void visit(block_statement const& node) override;
+    void visit(definition_statement const& node) override;
+    void visit(conditional_statement const& node) override;
+    void visit(while_statement const& node) override;
+};
+} // namespace rover
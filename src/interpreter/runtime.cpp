@@ -0,0 +1,18 @@
+#include "runtime.h"
+
+namespace rover {
+runtime::runtime(program const& p) : caches(p.cache_scopes, p.loop_count) {
+    constants.reserve(p.constants.size());
+    formats.resize(p.constants.size());
+    for (auto const& c : p.constants) {
+        if (auto const* s = std::get_if<std::string>(&c)) {
+            formats[constants.size()] = compile_format(*s);
+        }
+        constants.push_back(to_value(c));
+    }
+}
+
+value to_value(constant const& c) {
+    return std::visit([](auto const& v) { return value(v); }, c);
+}
+} // namespace rover
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include <ast.h>
+
+#include "context.h"
+#include "format.h"
+#include "loop_cache.h"
+#include "value.h"
+
+namespace rover {
+// State shared by all evaluators executing one program.
+struct runtime {
+    explicit runtime(program const& p);
+
+    // The program's constant pool, materialized once so that literals only need to be loaded.
+    std::vector<value> constants;
+    // String constants compiled as printf formats, indexed like `constants`.
+    std::vector<format_string> formats;
+    // Frames for the blocks being executed.
+    frame_pool frames;
+    loop_cache caches;
+};
+
+value to_value(constant const& c);
+} // namespace rover
@@ -0,0 +1,128 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace rover {
+thread_pool::thread_pool(std::size_t threads) { start(threads); }
+
+thread_pool::~thread_pool() { stop(); }
+
+void thread_pool::start(std::size_t threads) {
+    threads = std::max<std::size_t>(threads, 1);
+    for (std::size_t i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<queue>());
+    }
+    // The caller of run is the thread with queue 0.
+    for (std::size_t i = 1; i < threads; ++i) {
+        workers.emplace_back([this, i] { work(i); });
+    }
+}
+
+void thread_pool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    workers.clear();
+    queues.clear();
+    stopping = false;
+    // Workers started later begin waiting for batch 1, like the first ones.
+    batch = 0;
+    task = nullptr;
+}
+
+void thread_pool::set_size(std::size_t threads) {
+    stop();
+    start(threads);
+}
+
+void thread_pool::work(std::size_t id) {
+    std::size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || batch != seen; });
+        if (stopping) {
+            return;
+        }
+
+        seen = batch;
+        auto const& job = *task;
+        lock.unlock();
+        drain(id, job);
+        lock.lock();
+        if (--busy == 0) {
+            task = nullptr;
+            idle.notify_all();
+        }
+    }
+}
+
+void thread_pool::drain(std::size_t id, std::function<void(std::size_t)> const& job) {
+    auto take = [&](std::size_t from, std::size_t& next) {
+        auto& q = *queues[from];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) {
+            return false;
+        }
+        if (from == id) {
+            next = q.tasks.front();
+            q.tasks.pop_front();
+        } else {
+            next = q.tasks.back();
+            q.tasks.pop_back();
+        }
+        return true;
+    };
+
+    // No tasks are added while a batch runs, so once every queue was found empty the batch is done.
+    std::size_t next;
+    while (true) {
+        bool found = false;
+        for (std::size_t k = 0; k < queues.size() && !found; ++k) {
+            found = take((id + k) % queues.size(), next);
+        }
+        if (!found) {
+            return;
+        }
+        job(next);
+    }
+}
+
+void thread_pool::run(std::size_t count, std::function<void(std::size_t)> const& job) {
+    if (count <= 1 || queues.size() == 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            job(i);
+        }
+        return;
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        auto& q = *queues[i % queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(i);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &job;
+        ++batch;
+        busy = workers.size();
+    }
+    wake.notify_all();
+
+    drain(0, job);
+
+    // Every worker takes part in every batch, so none of them is left holding `job` once this returns.
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] { return busy == 0; });
+}
+
+thread_pool& pool() {
+    static thread_pool threads(std::thread::hardware_concurrency());
+    return threads;
+}
+} // namespace rover
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rover {
+// Threads running the tasks of the parallel builtins. Every call to run hands out a batch of
+// numbered tasks: each thread, including the caller's, gets its own queue of them, and one whose
+// queue runs out steals tasks from the far end of the others'. Tasks must not touch values, whose
+// reference counts are not atomic, or report errors; they work on the packed storage of arrays.
+class thread_pool {
+private:
+    struct queue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<queue>> queues;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::function<void(std::size_t)> const* task = nullptr;
+    std::size_t batch = 0;
+    std::size_t busy = 0; // workers that have not finished the current batch
+    bool stopping = false;
+
+    void start(std::size_t threads);
+    void stop();
+    void work(std::size_t id);
+    // Runs tasks until every queue is empty, taking them from the front of queue `id` and from the
+    // back of the others.
+    void drain(std::size_t id, std::function<void(std::size_t)> const& job);
+
+public:
+    // A pool of `threads` threads in total, the caller of run being one of them.
+    explicit thread_pool(std::size_t threads);
+    ~thread_pool();
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+
+    std::size_t size() const { return queues.size(); }
+    void set_size(std::size_t threads);
+
+    // Calls `job` with every number below `count` and returns once all calls have returned.
+    void run(std::size_t count, std::function<void(std::size_t)> const& job);
+};
+
+// The pool of the parallel builtins, as large as the number of hardware threads unless resized.
+thread_pool& pool();
+} // namespace rover
@@ -0,0 +1,188 @@
+#include "type_checker.h"
+
+#include "builtins.h"
+#include "operations.h"
+
+namespace rover {
+namespace {
+bool is_number(static_type type) { return type == static_type::int_type || type == static_type::double_type; }
+
+bool is_comparison(token_type op) {
+    return op == token_type::EQUAL || op == token_type::NOT_EQUAL || op == token_type::LESS_THAN ||
+           op == token_type::GREATER_THAN || op == token_type::LESS_EQUAL || op == token_type::GREATER_EQUAL;
+}
+
+std::string describe(static_type type) {
+    switch (type) {
+    case static_type::int_type:
+        return "an integer";
+    case static_type::double_type:
+        return "a double";
+    case static_type::string_type:
+        return "a string";
+    case static_type::array_type:
+        return "an array";
+    default:
+        return "a value";
+    }
+}
+} // namespace
+
+type_checker::type_checker() : program_(nullptr), next_variable(0), changed(false) {}
+type_checker::~type_checker() {}
+
+void type_checker::check(program const& p, std::size_t globals) {
+    program_ = &p;
+    variables.clear();
+
+    do {
+        changed = false;
+        errors_.clear();
+        frames.clear();
+        next_variable = 0;
+        enter_frame(globals);
+
+        for (auto const& stmt : p.statements) {
+            stmt->accept(*this);
+        }
+    } while (changed);
+}
+
+void type_checker::enter_frame(std::size_t size) {
+    frames.push_back(next_variable);
+    next_variable += size;
+    if (variables.size() < next_variable) {
+        variables.resize(next_variable);
+    }
+}
+
+std::optional<static_type>& type_checker::variable(identifier_expression const& node) {
+    return variables[frames[frames.size() - 1 - node.depth] + node.slot];
+}
+
+void type_checker::store(std::optional<static_type>& variable, static_type type) {
+    if (!variable) {
+        variable = type;
+        changed = true;
+    } else if (*variable != type && *variable != static_type::dynamic) {
+        variable = static_type::dynamic;
+        changed = true;
+    }
+}
+
+void type_checker::visit(binary_op_expression const& node) {
+    if (node.op.type == token_type::ASSIGN) {
+        node.right->accept(*this);
+        node.left->accept(*this);
+        if (auto const* target = node.left->as<identifier_expression>()) {
+            // Variables are assigned unless they are constants, which the resolver rejects.
+            store(variable(*target), node.right->type);
+            node.type = node.right->type;
+        } else {
+            node.type = static_type::dynamic;
+        }
+        return;
+    }
+
+    node.left->accept(*this);
+    node.right->accept(*this);
+    auto left = node.left->type;
+    auto right = node.right->type;
+
+    node.quickened = static_cast<std::uint8_t>(quicken(node.op.type, left, right));
+    if (left == right && is_number(left)) {
+        node.type = is_comparison(node.op.type) ? static_type::int_type : left;
+    } else {
+        if (left != static_type::dynamic && right != static_type::dynamic) {
+            report_error("Operator " + std::string(program_->source->text(node.op)) +
+                             " requires two integers or two doubles, but is applied to " + describe(left) + " and " +
+                             describe(right),
+                         node.op);
+        }
+        node.type = static_type::dynamic;
+    }
+}
+
+void type_checker::visit(unary_op_expression const& node) {
+    node.right->accept(*this);
+    auto operand = node.right->type;
+
+    node.quickened = static_cast<std::uint8_t>(quicken(node.op.type, operand));
+    if (is_number(operand)) {
+        node.type = node.op.type == token_type::NOT ? static_type::int_type : operand;
+    } else {
+        if (operand != static_type::dynamic) {
+            report_error("Unary operator '" + std::string(program_->source->text(node.op)) +
+                             "' requires an integer or double, but is applied to " + describe(operand),
+                         node.op);
+        }
+        node.type = static_type::dynamic;
+    }
+}
+
+void type_checker::visit(literal_expression const& node) {
+    static constexpr static_type types[] = {static_type::int_type, static_type::double_type, static_type::string_type};
+    node.type = types[program_->constants[node.constant].index()];
+}
+
+void type_checker::visit(identifier_expression const& node) {
+    auto const& type = variable(node);
+    node.type = type ? *type : static_type::dynamic;
+}
+
+void type_checker::visit(function_call_expression const& node) {
+    for (auto const& arg : node.arguments) {
+        arg->accept(*this);
+    }
+
+    auto measures_array = node.function == length_builtin && node.arguments.size() == 1 &&
+                          node.arguments.front()->type == static_type::array_type;
+    node.type = measures_array ? static_type::int_type : static_type::dynamic;
+}
+
+void type_checker::visit(array_literal_expression const& node) {
+    for (auto const& element : node.elements) {
+        element->accept(*this);
+    }
+    node.type = static_type::array_type;
+}
+
+void type_checker::visit(array_ref_expression const& node) {
+    node.index->accept(*this);
+    node.array->accept(*this);
+    node.type = static_type::dynamic;
+}
+
+void type_checker::visit(cached_expression const& node) {
+    node.inner->accept(*this);
+    node.type = node.inner->type;
+}
+
+void type_checker::visit(expression_statement const& node) { node.expr->accept(*this); }
+
+void type_checker::visit(block_statement const& node) {
+    enter_frame(node.frame_size);
+    for (auto const& stmt : node.statements) {
+        stmt->accept(*this);
+    }
+    frames.pop_back();
+}
+
+void type_checker::visit(definition_statement const& node) {
+    node.initializer->accept(*this);
+    store(variables[frames.back() + node.slot], node.initializer->type);
+}
+
+void type_checker::visit(conditional_statement const& node) {
+    node.condition->accept(*this);
+    node.then_branch->accept(*this);
+    if (node.else_branch) {
+        node.else_branch->accept(*this);
+    }
+}
+
+void type_checker::visit(while_statement const& node) {
+    node.condition->accept(*this);
+    node.body->accept(*this);
+}
+} // namespace rover
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <ast.h>
+
+namespace rover {
+// Infers the type of every expression of a resolved program (see static_type) and reports operators
+// applied to operands of types they never accept, which would fail every time they run. It also
+// specializes the operators whose operand types it knows (see quick_op). A variable has a type if
+// every value it is initialized with or assigned has that type. Since the type of an assigned value
+// can depend on variables assigned later in the program, the program is checked until the types of
+// all variables are stable.
+class type_checker : public expression_visitor, public statement_visitor {
+private:
+    program const* program_;
+    // The type of every variable, unset until a value is stored into it. Every block gets new entries
+    // each time the checker enters it.
+    std::vector<std::optional<static_type>> variables;
+    // The first entry of every frame enclosing the node being checked, innermost last.
+    std::vector<std::size_t> frames;
+    std::size_t next_variable;
+    // Whether a variable's type changed during the current pass.
+    bool changed;
+    std::vector<std::string> errors_;
+
+    void enter_frame(std::size_t size);
+    std::optional<static_type>& variable(identifier_expression const& node);
+    void store(std::optional<static_type>& variable, static_type type);
+
+    void report_error(std::string const& message, token const& t) {
+        auto position = program_->source->position(t);
+        errors_.push_back(message + " in line " + std::to_string(position.line) + ", column " +
+                          std::to_string(position.column));
+    }
+
+public:
+    type_checker();
+    virtual ~type_checker();
+
+    // Checks a resolved program whose global frame holds `globals` variables.
+    void check(program const& p, std::size_t globals);
+    std::vector<std::string> errors() const { return errors_; }
+
+    void visit(binary_op_expression const& node) override;
+    void visit(unary_op_expression const& node) override;
+    void visit(literal_expression const& node) override;
+    void visit(identifier_expression const& node) override;
+    void visit(function_call_expression const& node) override;
+    void visit(array_literal_expression const& node) override;
+    void visit(array_ref_expression const& node) override;
+    void visit(cached_expression const& node) override;
+
+    void visit(expression_statement const& node) override;
+    void visit(block_statement const& node) override;
+    void visit(definition_statement const& node) override;
+    void visit(conditional_statement const& node) override;
+    void visit(while_statement const& node) override;
+};
+} // namespace rover
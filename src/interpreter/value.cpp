@@ -0,0 +1,124 @@
+#include "value.h"
+
+namespace rover {
+array::array(std::vector<value> elements) : storage_(storage::bytes) {
+    if (!elements.empty()) {
+        storage_ = storage_of(elements.front());
+        for (auto const& element : elements) {
+            if (storage_of(element) != storage_) {
+                storage_ = storage::values;
+                break;
+            }
+        }
+    }
+
+    switch (storage_) {
+    case storage::bytes:
+        bytes_.reserve(elements.size());
+        for (auto const& element : elements) {
+            bytes_.push_back(static_cast<std::uint8_t>(element.as_int()));
+        }
+        break;
+    case storage::doubles:
+        doubles_.reserve(elements.size());
+        for (auto const& element : elements) {
+            doubles_.push_back(element.as_double());
+        }
+        break;
+    case storage::values:
+        values_ = std::move(elements);
+        break;
+    }
+}
+
+array::storage array::storage_of(value const& v) {
+    if (v.is_int() && v.as_int() >= 0 && v.as_int() <= 255) {
+        return storage::bytes;
+    } else if (v.is_double()) {
+        return storage::doubles;
+    } else {
+        return storage::values;
+    }
+}
+
+void array::generalize() {
+    if (storage_ == storage::values) {
+        return;
+    }
+
+    values_.reserve(size());
+    for (std::size_t i = 0; i < size(); ++i) {
+        values_.push_back((*this)[i]);
+    }
+    // Swapping with empty vectors releases the packed buffers.
+    std::vector<std::uint8_t>().swap(bytes_);
+    std::vector<double>().swap(doubles_);
+    storage_ = storage::values;
+}
+
+void array::set(std::size_t i, value v) {
+    auto kind = storage_of(v);
+    if (kind == storage_ && kind == storage::bytes) {
+        bytes_[i] = static_cast<std::uint8_t>(v.as_int());
+    } else if (kind == storage_ && kind == storage::doubles) {
+        doubles_[i] = v.as_double();
+    } else {
+        generalize();
+        values_[i] = std::move(v);
+    }
+}
+
+void array::push(value v) {
+    auto kind = storage_of(v);
+    if (size() == 0) {
+        storage_ = kind;
+    }
+
+    if (kind == storage_ && kind == storage::bytes) {
+        bytes_.push_back(static_cast<std::uint8_t>(v.as_int()));
+    } else if (kind == storage_ && kind == storage::doubles) {
+        doubles_.push_back(v.as_double());
+    } else {
+        generalize();
+        values_.push_back(std::move(v));
+    }
+}
+
+value array::pop() {
+    value last = (*this)[size() - 1];
+    switch (storage_) {
+    case storage::bytes:
+        bytes_.pop_back();
+        break;
+    case storage::doubles:
+        doubles_.pop_back();
+        break;
+    case storage::values:
+        values_.pop_back();
+        break;
+    }
+    return last;
+}
+
+void array::fill(value const& v) {
+    auto count = size();
+    auto kind = storage_of(v);
+    if (kind != storage_) {
+        // Releases the buffer of the old storage.
+        *this = array(std::vector<value>());
+        storage_ = kind;
+    }
+
+    switch (storage_) {
+    case storage::bytes:
+        bytes_.assign(count, static_cast<std::uint8_t>(v.as_int()));
+        break;
+    case storage::doubles:
+        doubles_.assign(count, v.as_double());
+        break;
+    case storage::values:
+        values_.assign(count, v);
+        break;
+    }
+}
+} // namespace rover
@@ -1,13 +1,225 @@
 #pragma once
 
-#include <optional>
+#include <cstdint>
+#include <cstring>
 #include <string>
-#include <variant>
+#include <utility>
 #include <vector>
 
 namespace rover {
-struct value {
-    std::variant<int, double, std::string, std::vector<value>, std::nullopt_t> val;
-    bool is_const;
+class array;
+
+// A value of a program in 8 bytes. Doubles are stored as they are. Every other value is stored in a
+// negative quiet NaN: its top 16 bits tell whether it holds an int, a pointer to a string or an array,
+// or is the invalid value of an operation that failed, and the rest holds the int or the pointer. The
+// only doubles that look like that are NaNs that arithmetic never produces, which are stored as the
+// default NaN instead.
+//
+// Strings and arrays are shared by all copies of a value, so copying is O(1). An array is duplicated
+// only when a shared array is about to be modified.
+class value {
+private:
+    static constexpr std::uint64_t int_tag = 0xFFFCull << 48;
+    static constexpr std::uint64_t string_tag = 0xFFFDull << 48;
+    static constexpr std::uint64_t array_tag = 0xFFFEull << 48;
+    static constexpr std::uint64_t invalid_bits = 0xFFFFull << 48;
+    static constexpr std::uint64_t tag_mask = 0xFFFFull << 48;
+    static constexpr std::uint64_t default_nan = 0xFFF8ull << 48;
+
+    static_assert(sizeof(void*) <= sizeof(std::uint64_t), "pointers must fit into the payload of a value");
+
+    struct string_object {
+        std::size_t references;
+        std::string text;
+    };
+    struct array_object;
+
+    std::uint64_t bits;
+
+    template <typename T>
+    static T* object(std::uint64_t boxed) {
+        return reinterpret_cast<T*>(static_cast<std::uintptr_t>(boxed & ~tag_mask));
+    }
+
+    template <typename T>
+    static std::uint64_t box(std::uint64_t tag, T* object) {
+        return tag | static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(object));
+    }
+
+    // Whether the value points to a string or an array, which is checked by a single comparison.
+    static bool is_object(std::uint64_t boxed) { return boxed - string_tag < invalid_bits - string_tag; }
+
+    static void retain(std::uint64_t boxed) {
+        if (is_object(boxed)) {
+            retain_object(boxed);
+        }
+    }
+
+    void release() {
+        if (is_object(bits)) {
+            release_object();
+        }
+    }
+
+    static void retain_object(std::uint64_t boxed);
+    void release_object();
+
+public:
+    // The invalid value.
+    value() : bits(invalid_bits) {}
+    value(int v) : bits(int_tag | static_cast<std::uint32_t>(v)) {}
+    value(double v) {
+        std::memcpy(&bits, &v, sizeof bits);
+        if (bits >= int_tag) {
+            bits = default_nan;
+        }
+    }
+    explicit value(std::string text) : bits(box(string_tag, new string_object{1, std::move(text)})) {}
+    explicit value(std::vector<value> elements);
+
+    value(value const& other) : bits(other.bits) { retain(bits); }
+    value(value&& other) noexcept : bits(other.bits) { other.bits = invalid_bits; }
+    ~value() { release(); }
+
+    // Both assignments take the other value before releasing their own, which may own it.
+    value& operator=(value const& other) {
+        auto b = other.bits;
+        retain(b);
+        release();
+        bits = b;
+        return *this;
+    }
+
+    value& operator=(value&& other) noexcept {
+        auto b = other.bits;
+        other.bits = invalid_bits;
+        release();
+        bits = b;
+        return *this;
+    }
+
+    bool is_valid() const { return bits != invalid_bits; }
+    bool is_int() const { return (bits & tag_mask) == int_tag; }
+    bool is_double() const { return bits < int_tag; }
+    bool is_string() const { return (bits & tag_mask) == string_tag; }
+    bool is_array() const { return (bits & tag_mask) == array_tag; }
+
+    int as_int() const { return static_cast<int>(static_cast<std::uint32_t>(bits)); }
+    double as_double() const {
+        double v;
+        std::memcpy(&v, &bits, sizeof v);
+        return v;
+    }
+    std::string const& as_string() const { return object<string_object>(bits)->text; }
+
+    array const& as_array() const;
+    // The array, copied first if other values share it.
+    array& mutable_array();
 };
+
+// The elements of an array. An array whose elements are all ints that fit into a byte or all doubles
+// stores them packed. Storing an element of another type (or an int that does not fit, which only a
+// literal can be) converts it to generic values for good, except that an empty array takes on the
+// storage of the next element pushed to it.
+class array {
+public:
+    enum class storage : std::uint8_t { bytes, doubles, values };
+
+private:
+    storage storage_;
+    std::vector<std::uint8_t> bytes_;
+    std::vector<double> doubles_;
+    std::vector<value> values_;
+
+    static storage storage_of(value const& v);
+    void generalize();
+
+public:
+    explicit array(std::vector<value> elements);
+
+    storage kind() const { return storage_; }
+    std::size_t size() const;
+    value operator[](std::size_t i) const;
+    // The element at `i` if the array stores values, null if it stores its elements packed.
+    value* element(std::size_t i) { return storage_ == storage::values ? &values_[i] : nullptr; }
+
+    void set(std::size_t i, value v);
+    void push(value v);
+    // Removes the last element, which the array must have, and returns it.
+    value pop();
+    // Replaces every element with `v`, storing them the way an array of `v`s would.
+    void fill(value const& v);
+
+    std::vector<std::uint8_t> const& bytes() const { return bytes_; }
+    std::vector<std::uint8_t>& bytes() { return bytes_; }
+    std::vector<double> const& doubles() const { return doubles_; }
+    std::vector<double>& doubles() { return doubles_; }
+    std::vector<value> const& values() const { return values_; }
+};
+
+struct value::array_object {
+    std::size_t references;
+    array elements;
+};
+
+inline value::value(std::vector<value> elements)
+    : bits(box(array_tag, new array_object{1, array(std::move(elements))})) {}
+
+inline void value::retain_object(std::uint64_t boxed) {
+    if ((boxed & tag_mask) == string_tag) {
+        ++object<string_object>(boxed)->references;
+    } else {
+        ++object<array_object>(boxed)->references;
+    }
+}
+
+inline void value::release_object() {
+    if (is_string()) {
+        auto* s = object<string_object>(bits);
+        if (--s->references == 0) {
+            delete s;
+        }
+    } else {
+        auto* a = object<array_object>(bits);
+        if (--a->references == 0) {
+            delete a;
+        }
+    }
+}
+
+inline array const& value::as_array() const { return object<array_object>(bits)->elements; }
+
+inline array& value::mutable_array() {
+    auto* a = object<array_object>(bits);
+    if (a->references > 1) {
+        --a->references;
+        a = new array_object{1, a->elements};
+        bits = box(array_tag, a);
+    }
+    return a->elements;
+}
+
+inline std::size_t array::size() const {
+    switch (storage_) {
+    case storage::bytes:
+        return bytes_.size();
+    case storage::doubles:
+        return doubles_.size();
+    default:
+        return values_.size();
+    }
+}
+
+inline value array::operator[](std::size_t i) const {
+    switch (storage_) {
+    case storage::bytes:
+        return static_cast<int>(bytes_[i]);
+    case storage::doubles:
+        return doubles_[i];
+    default:
+        return values_[i];
+    }
+}
+
+static_assert(sizeof(value) == 8, "values must fit into 8 bytes");
 } // namespace rover
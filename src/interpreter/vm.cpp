@@ -0,0 +1,188 @@
+#include "vm.h"
+
+#include <algorithm>
+
+#include "builtins.h"
+#include "format.h"
+#include "loop_cache.h"
+#include "operations.h"
+
+namespace rover {
+vm::vm() {}
+
+value vm::pop() {
+    auto v = std::move(stack.back());
+    stack.pop_back();
+    return v;
+}
+
+// Moves `v` into `target` and replaces it with the value of the assignment expression.
+void vm::store(value* target, value& v) {
+    if (assign(target, std::move(v))) {
+        v = *target;
+        wrap_integer(v);
+    } else {
+        v = value();
+    }
+}
+
+value* vm::slot(std::int32_t index) { return index == no_slot ? nullptr : &slots[index]; }
+
+value* vm::element(std::int32_t index, value const* indices, std::int32_t count) {
+    return element_at(slot(index), indices, static_cast<std::size_t>(count));
+}
+
+void vm::run(chunk program) {
+    stack.clear();
+    slots.assign(program.slot_count, value());
+    loop_cache caches(program.cache_scopes, program.loop_count);
+
+    auto* code = program.code.data();
+    auto const* end = code + program.code.size();
+
+    for (auto* ip = code; ip != end;) {
+        auto& ins = *ip++;
+
+        switch (ins.op) {
+        case opcode::CONSTANT:
+            stack.push_back(program.constants[ins.a]);
+            break;
+        case opcode::POP:
+            stack.pop_back();
+            break;
+        case opcode::LOAD:
+            if (auto* v = slot(ins.a)) {
+                stack.push_back(*v);
+            } else {
+                report_error("Variable not found.");
+                stack.emplace_back();
+            }
+            break;
+        case opcode::DEFINE:
+            slots[ins.a] = pop();
+            break;
+        case opcode::STORE:
+            store(slot(ins.a), stack.back());
+            break;
+        case opcode::LOAD_ELEMENT: {
+            auto index = pop();
+            stack.back() = element_of(stack.back(), index);
+            break;
+        }
+        case opcode::STORE_ELEMENT: {
+            // The last index selects the element, the others the array it is stored into.
+            auto indices = stack.size() - ins.b;
+            auto* array = element(ins.a, stack.data() + indices, ins.b - 1);
+            auto& v = stack[indices - 1];
+            v = assign_element(array, stack.back(), std::move(v));
+            wrap_integer(v);
+            stack.erase(stack.begin() + indices, stack.end());
+            break;
+        }
+        case opcode::BINARY: {
+            auto const& right = stack.back();
+            auto& left = stack[stack.size() - 2];
+            if (!quick_binary(static_cast<quick_op>(ins.b), left, right, left)) {
+                auto op = static_cast<token_type>(ins.a);
+                ins.b = static_cast<std::int32_t>(quicken(op, left, right));
+                left = binary_operation(op, left, right);
+            }
+            stack.pop_back();
+            break;
+        }
+        case opcode::UNARY:
+            if (!quick_unary(static_cast<quick_op>(ins.b), stack.back(), stack.back())) {
+                auto op = static_cast<token_type>(ins.a);
+                ins.b = static_cast<std::int32_t>(quicken(op, stack.back()));
+                stack.back() = unary_operation(op, stack.back());
+            }
+            break;
+        case opcode::ARRAY: {
+            auto first = stack.begin() + (stack.size() - ins.a);
+            std::vector<value> elements;
+            elements.reserve(ins.a);
+            for (auto it = first; it != stack.end(); ++it) {
+                elements.push_back(std::move(*it));
+            }
+            stack.erase(first, stack.end());
+            stack.emplace_back(std::move(elements));
+            break;
+        }
+        case opcode::JUMP:
+            ip = code + ins.a;
+            break;
+        case opcode::JUMP_IF_FALSE:
+            if (!is_truthy(pop())) {
+                ip = code + ins.a;
+            }
+            break;
+        case opcode::PRINTF: {
+            auto args = stack.size() - ins.a;
+            auto result = builtin_printf(stack.data() + args, ins.a);
+            stack.erase(stack.begin() + args, stack.end());
+            stack.push_back(std::move(result));
+            break;
+        }
+        case opcode::FORMAT: {
+            auto args = stack.size() - ins.a;
+            auto result = print_format(program.formats[ins.b], stack.data() + args, ins.a);
+            stack.erase(stack.begin() + args, stack.end());
+            stack.push_back(std::move(result));
+            break;
+        }
+        case opcode::LENGTH:
+            stack.back() = builtin_length(stack.back());
+            break;
+        case opcode::PUSH: {
+            auto indices = stack.size() - ins.b - 1;
+            auto result = builtin_push(element(ins.a, stack.data() + indices, ins.b), stack.back());
+            stack.erase(stack.begin() + indices, stack.end());
+            stack.push_back(std::move(result));
+            break;
+        }
+        case opcode::POP_BACK: {
+            auto indices = stack.size() - ins.b;
+            auto result = builtin_pop(element(ins.a, stack.data() + indices, ins.b));
+            stack.erase(stack.begin() + indices, stack.end());
+            stack.push_back(std::move(result));
+            break;
+        }
+        case opcode::CALL: {
+            auto args = stack.size() - ins.b;
+            auto result = builtins()[ins.a].function(nullptr, stack.data() + args, ins.b);
+            stack.erase(stack.begin() + args, stack.end());
+            stack.push_back(std::move(result));
+            break;
+        }
+        case opcode::CALL_TARGET: {
+            auto const& call = program.targeted_calls[ins.a];
+            auto args = stack.size() - call.arguments;
+            auto indices = args - call.indices;
+            auto* target = element(call.slot, stack.data() + indices, call.indices);
+            auto result = builtins()[call.function].function(target, stack.data() + args, call.arguments);
+            stack.erase(stack.begin() + indices, stack.end());
+            stack.push_back(std::move(result));
+            break;
+        }
+        case opcode::CLEAR:
+            std::fill_n(slots.begin() + ins.a, ins.b, value());
+            break;
+        case opcode::CACHED:
+            if (auto const* cached = caches.find(ins.a)) {
+                stack.push_back(*cached);
+                ip = code + ins.b;
+            }
+            break;
+        case opcode::CACHE:
+            caches.store(ins.a, stack.back());
+            break;
+        case opcode::ENTER_LOOP:
+            caches.enter_loop(ins.a);
+            break;
+        case opcode::ITERATE:
+            caches.next_iteration(ins.a);
+            break;
+        }
+    }
+}
+} // namespace rover
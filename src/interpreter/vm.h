@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include "bytecode.h"
+#include "value.h"
+
+namespace rover {
+class vm {
+private:
+    std::vector<value> stack;
+    std::vector<value> slots;
+
+    value pop();
+    void store(value* target, value& v);
+    value* slot(std::int32_t index);
+    value* element(std::int32_t slot, value const* indices, std::int32_t count);
+
+public:
+    vm();
+
+    // Runs a chunk. The chunk is the virtual machine's own copy, since operators are quickened by
+    // rewriting their instructions.
+    void run(chunk program);
+};
+} // namespace rover
@@ -1,220 +1,175 @@
 #include "lexer.h"
 
-#include <algorithm>
+#include <cctype>
 
 namespace rover {
-lexer::lexer(std::istream& input) : input(input), line(1), column(0) {}
+// The <cctype> classifications, for chars that may be negative.
+static bool is_space(char c) { return std::isspace(static_cast<unsigned char>(c)); }
+static bool is_digit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+static bool is_alpha(char c) { return std::isalpha(static_cast<unsigned char>(c)); }
+static bool is_alnum(char c) { return std::isalnum(static_cast<unsigned char>(c)); }
 
-std::optional<token> lexer::emit(token const& t) {
-    peeked = {t};
-    return peeked;
-}
+lexer::lexer(std::istream& input) : lexer(source_buffer::read(input)) {}
 
-std::basic_istream<char>& lexer::get(char& c) {
-    auto& ret = input.get(c);
+lexer::lexer(std::shared_ptr<source_buffer const> source)
+    : source_(std::move(source)), text(source_->text()), position(0), peeked{}, consumed{}, has_peeked(false) {}
 
-    if (c == '\n') {
-        column = 0;
-        ++line;
-    } else {
-        ++column;
-    }
+lexer::lexer(std::string_view text_) : lexer(source_buffer::borrow(text_)) {}
 
-    return ret;
+token const* lexer::emit(token_type type, std::uint32_t start, symbol name) {
+    peeked = token{type, start, position - start, name};
+    has_peeked = true;
+    return &peeked;
 }
 
-std::basic_istream<char>& lexer::unget() {
-    auto& ret = input.unget();
-
-    --column;
-
-    if (column < 0) {
-        column = 0;
-        --line;
+bool lexer::match(char expected) {
+    if (position == text.size() || text[position] != expected) {
+        return false;
     }
 
-    return ret;
+    ++position;
+    return true;
 }
 
-std::optional<token> lexer::consume() {
-    if (!peeked) {
-        peek();
+token const* lexer::consume() {
+    if (!has_peeked && !peek()) {
+        return nullptr;
     }
 
-    auto t = peeked;
-    peeked = {};
-    return t;
+    consumed = peeked;
+    has_peeked = false;
+    return &consumed;
 }
 
-std::optional<token> lexer::consume_if(std::vector<token_type> const& types) {
-    if (!peeked) {
-        peek();
-    }
-
-    if (peeked && std::count_if(types.begin(), types.end(), [this](auto t) { return peeked->type == t; }) > 0) {
-        auto t = peeked;
-        peeked = {};
-        return t;
+token const* lexer::consume_if(token_set types) {
+    if (!has_peeked && !peek()) {
+        return nullptr;
     }
 
-    return {};
+    return types.contains(peeked.type) ? consume() : nullptr;
 }
 
-std::optional<token> lexer::peek() {
-    if (peeked) {
-        return peeked;
+token const* lexer::peek() {
+    if (has_peeked) {
+        return &peeked;
     }
 
-    if (!input) {
-        return emit(token{token_type::END_OF_FILE, line, column, {}});
+    while (position < text.size() && is_space(text[position])) {
+        ++position;
     }
 
-    char c;
-    while (get(c) && std::isspace(c))
-        ;
-
-    if (!input) {
-        return emit(token{token_type::END_OF_FILE, {}});
+    auto start = position;
+    if (position == text.size()) {
+        return emit(token_type::END_OF_FILE, start);
     }
 
-    auto start_column = column;
-
-    if (std::isalpha(c)) {
-        std::string s;
-        s += c;
-        get(c);
+    auto c = text[position++];
 
-        while (std::isalnum(c) || c == '_') {
-            s += c;
-            get(c);
+    if (is_alpha(c)) {
+        while (position < text.size() && (is_alnum(text[position]) || text[position] == '_')) {
+            ++position;
         }
-        unget();
+        auto s = text.substr(start, position - start);
 
         if (s == "if") {
-            return emit(token{token_type::IF, line, start_column, {}});
+            return emit(token_type::IF, start);
         } else if (s == "else") {
-            return emit(token{token_type::ELSE, line, start_column, {}});
+            return emit(token_type::ELSE, start);
         } else if (s == "while") {
-            return emit(token{token_type::WHILE, line, start_column, {}});
+            return emit(token_type::WHILE, start);
         } else if (s == "var") {
-            return emit(token{token_type::VAR, line, start_column, {}});
+            return emit(token_type::VAR, start);
         } else if (s == "const") {
-            return emit(token{token_type::CONST, line, start_column, {}});
+            return emit(token_type::CONST, start);
         } else {
-            return emit(token{token_type::IDENTIFIER, line, start_column, {s}});
+            return emit(token_type::IDENTIFIER, start, symbols().intern(s));
         }
-    } else if (std::isdigit(c)) {
-        std::string s;
-        s += c;
-
-        while (get(c) && std::isdigit(c)) {
-            s += c;
+    } else if (is_digit(c)) {
+        while (position < text.size() && is_digit(text[position])) {
+            ++position;
         }
 
-        if (c == '.') {
-            s += c;
-            while (get(c) && std::isdigit(c)) {
-                s += c;
+        if (match('.')) {
+            while (position < text.size() && is_digit(text[position])) {
+                ++position;
             }
-            unget();
-
-            return emit(token{token_type::FLOAT, line, start_column, s});
+            return emit(token_type::FLOAT, start);
         } else {
-            unget();
-            return emit(token{token_type::INT, line, start_column, s});
+            return emit(token_type::INT, start);
         }
     } else if (c == '\0') {
-        return emit(token{token_type::END_OF_FILE, line, start_column, {}});
+        return emit(token_type::END_OF_FILE, start);
     } else if (c == '+') {
-        return emit(token{token_type::PLUS, line, start_column, {}});
+        return emit(token_type::PLUS, start);
     } else if (c == '-') {
-        return emit(token{token_type::MINUS, line, start_column, {}});
+        return emit(token_type::MINUS, start);
     } else if (c == '*') {
-        return emit(token{token_type::STAR, line, start_column, {}});
+        return emit(token_type::STAR, start);
     } else if (c == '/') {
-        char next;
-        get(next);
-        if (next == '/') {
-            while (get(next) && next != '\n')
+        if (match('/')) {
+            while (position < text.size() && text[position++] != '\n')
                 ;
             return peek();
         } else {
-            unget();
-            return emit(token{token_type::SLASH, line, start_column, {}});
+            return emit(token_type::SLASH, start);
         }
     } else if (c == '=') {
-        char next;
-        get(next);
-        if (next == '=') {
-            return emit(token{token_type::EQUAL, line, start_column, {}});
-        } else {
-            unget();
-            return emit(token{token_type::ASSIGN, line, start_column, {}});
-        }
+        return emit(match('=') ? token_type::EQUAL : token_type::ASSIGN, start);
     } else if (c == '!') {
-        char next;
-        get(next);
-        if (next == '=') {
-            return emit(token{token_type::NOT_EQUAL, line, start_column, {}});
-        } else {
-            unget();
-            return emit(token{token_type::NOT, line, start_column, {}});
-        }
+        return emit(match('=') ? token_type::NOT_EQUAL : token_type::NOT, start);
     } else if (c == '<') {
-        char next;
-        get(next);
-        if (next == '=') {
-            return emit(token{token_type::LESS_EQUAL, line, start_column, {}});
-        } else {
-            unget();
-            return emit(token{token_type::LESS_THAN, line, start_column, {}});
-        }
+        return emit(match('=') ? token_type::LESS_EQUAL : token_type::LESS_THAN, start);
     } else if (c == '>') {
-        char next;
-        get(next);
-        if (next == '=') {
-            return emit(token{token_type::GREATER_EQUAL, line, start_column, {}});
-        } else {
-            unget();
-            return emit(token{token_type::GREATER_THAN, line, start_column, {}});
-        }
+        return emit(match('=') ? token_type::GREATER_EQUAL : token_type::GREATER_THAN, start);
     } else if (c == '{') {
-        return emit(token{token_type::LEFT_BRACE, line, start_column, {}});
+        return emit(token_type::LEFT_BRACE, start);
     } else if (c == '}') {
-        return emit(token{token_type::RIGHT_BRACE, line, start_column, {}});
+        return emit(token_type::RIGHT_BRACE, start);
     } else if (c == '(') {
-        return emit(token{token_type::LEFT_PAREN, line, start_column, {}});
+        return emit(token_type::LEFT_PAREN, start);
     } else if (c == ')') {
-        return emit(token{token_type::RIGHT_PAREN, line, start_column, {}});
+        return emit(token_type::RIGHT_PAREN, start);
     } else if (c == '[') {
-        return emit(token{token_type::LEFT_SQUARE, line, start_column, {}});
+        return emit(token_type::LEFT_SQUARE, start);
     } else if (c == ']') {
-        return emit(token{token_type::RIGHT_SQUARE, line, start_column, {}});
+        return emit(token_type::RIGHT_SQUARE, start);
     } else if (c == ',') {
-        return emit(token{token_type::COMMA, line, start_column, {}});
+        return emit(token_type::COMMA, start);
     } else if (c == ';') {
-        return emit(token{token_type::SEMICOLON, line, start_column, {}});
+        return emit(token_type::SEMICOLON, start);
     } else if (c == '"') {
-        std::string str;
-        while (get(c)) {
+        // The token spans the quotes and everything between them, escaped quotes included; see
+        // string_value().
+        while (position < text.size()) {
+            c = text[position++];
             if (c == '\\') {
-                char next;
-                if (get(next)) {
-                    if (next == '"') {
-                        str += '"';
-                    } else {
-                        str += '\\';
-                        unget();
-                    }
-                }
+                match('"');
             } else if (c == '"') {
                 break;
-            } else {
-                str += c;
             }
         }
-        return emit(token{token_type::STRING, line, start_column, {str}});
+        return emit(token_type::STRING, start);
+    }
+    return nullptr;
+}
+
+std::string string_value(std::string_view literal) {
+    // Drop the quotes. The closing one is missing if the string runs until the end of the source,
+    // and a quote preceded by a backslash is always escaped.
+    literal.remove_prefix(1);
+    auto size = literal.size();
+    if (size && literal.back() == '"' && (size == 1 || literal[size - 2] != '\\')) {
+        literal.remove_suffix(1);
+    }
+
+    std::string value;
+    value.reserve(literal.size());
+    for (std::size_t i = 0; i < literal.size(); ++i) {
+        if (literal[i] == '\\' && i + 1 < literal.size() && literal[i + 1] == '"') {
+            ++i;
+        }
+        value += literal[i];
     }
-    return {};
+    return value;
 }
-} // namespace rover
\ No newline at end of file
+} // namespace rover
@@ -1,28 +1,45 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
-#include <optional>
-#include <vector>
+#include <memory>
+#include <string>
+#include <string_view>
 
+#include "source.h"
 #include "token.h"
 
 namespace rover {
+// Splits source text into tokens, which refer to their text by its span in source().
 class lexer {
 private:
-    std::istream& input;
-    std::optional<token> peeked;
-    std::size_t line;
-    std::size_t column;
+    std::shared_ptr<source_buffer const> source_;
+    std::string_view text;
+    std::uint32_t position;
+    // The lookahead, valid while has_peeked is set, and the token handed out by the last consume.
+    token peeked;
+    token consumed;
+    bool has_peeked;
 
-    std::optional<token> emit(token const& t);
-    std::basic_istream<char>& get(char& c);
-    std::basic_istream<char>& unget();
+    token const* emit(token_type type, std::uint32_t start, symbol name = no_symbol);
+    bool match(char expected);
 
 public:
+    // Reads the whole stream into a buffer owned by the lexer.
     lexer(std::istream& input);
-    std::optional<token> peek();
-    std::optional<token> consume();
-    std::optional<token> consume_if(std::vector<token_type> const& types);
+    explicit lexer(std::shared_ptr<source_buffer const> source);
+    // Lexes text owned by the caller, which has to outlive the tokens.
+    explicit lexer(std::string_view text_);
+
+    std::shared_ptr<source_buffer const> const& source() const { return source_; }
+
+    // These return null for text that is not a token. The token returned by peek() is valid until the
+    // next consume, the one returned by a consume until the one after it.
+    token const* peek();
+    token const* consume();
+    token const* consume_if(token_set types);
 };
 
+// The value of a string literal token with the given text, in which \" stands for a quote.
+std::string string_value(std::string_view literal);
 } // namespace rover
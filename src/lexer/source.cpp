@@ -0,0 +1,75 @@
+#include "source.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace rover {
+source_buffer::source_buffer() : mapping(nullptr), mapped_size(0) {}
+
+source_buffer::~source_buffer() {
+    if (mapping) {
+        munmap(mapping, mapped_size);
+    }
+}
+
+std::shared_ptr<source_buffer const> source_buffer::map(char const* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info;
+    bool mappable = fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0;
+    auto size = mappable ? static_cast<std::size_t>(info.st_size) : 0;
+    auto* mapping = mappable ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        // Empty files, pipes and anything else that cannot be mapped is read instead.
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            return nullptr;
+        }
+        return read(input);
+    }
+
+    std::shared_ptr<source_buffer> source(new source_buffer());
+    source->mapping = mapping;
+    source->mapped_size = size;
+    source->text_ = std::string_view(static_cast<char const*>(mapping), size);
+    return source;
+}
+
+std::shared_ptr<source_buffer const> source_buffer::borrow(std::string_view text) {
+    std::shared_ptr<source_buffer> source(new source_buffer());
+    source->text_ = text;
+    return source;
+}
+
+source_position source_buffer::position(std::uint32_t offset) const {
+    if (line_starts.empty()) {
+        line_starts.push_back(0);
+        for (std::uint32_t i = 0; i < text_.size(); ++i) {
+            if (text_[i] == '\n') {
+                line_starts.push_back(i + 1);
+            }
+        }
+    }
+
+    auto line = std::upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin();
+    return {static_cast<std::uint32_t>(line), offset - line_starts[line - 1] + 1};
+}
+
+std::shared_ptr<source_buffer const> source_buffer::read(std::istream& input) {
+    std::shared_ptr<source_buffer> source(new source_buffer());
+    source->owned.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    source->text_ = source->owned;
+    return source;
+}
+} // namespace rover
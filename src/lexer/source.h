@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "token.h"
+
+namespace rover {
+struct source_position {
+    std::uint32_t line;
+    std::uint32_t column;
+};
+
+// Text of a rover program. Tokens refer to spans of it instead of copying them, so it is shared
+// by the lexer and the program it is parsed into, and lives as long as either of them.
+class source_buffer {
+private:
+    std::string owned;
+    void* mapping;
+    std::size_t mapped_size;
+    std::string_view text_;
+    // Offsets at which lines start, computed on first use.
+    mutable std::vector<std::uint32_t> line_starts;
+
+    source_buffer();
+
+public:
+    ~source_buffer();
+    source_buffer(source_buffer const&) = delete;
+    source_buffer& operator=(source_buffer const&) = delete;
+
+    // Maps the file into memory. Returns null if it cannot be opened.
+    static std::shared_ptr<source_buffer const> map(char const* path);
+    // Reads the rest of the stream into a buffer.
+    static std::shared_ptr<source_buffer const> read(std::istream& input);
+    // Refers to text owned by the caller, which has to outlive the buffer.
+    static std::shared_ptr<source_buffer const> borrow(std::string_view text);
+
+    std::string_view text() const { return text_; }
+    std::string_view text(token const& t) const { return text_.substr(t.offset, t.length); }
+
+    // Line and column, both starting at 1, of the character at the given offset.
+    source_position position(std::uint32_t offset) const;
+    source_position position(token const& t) const { return position(t.offset); }
+};
+} // namespace rover
@@ -0,0 +1,20 @@
+#include "symbol.h"
+
+namespace rover {
+symbol symbol_table::intern(std::string_view name) {
+    auto it = symbols.find(name);
+    if (it != symbols.end()) {
+        return it->second;
+    }
+
+    auto s = static_cast<symbol>(names.size());
+    names.emplace_back(name);
+    symbols.emplace(names.back(), s);
+    return s;
+}
+
+symbol_table& symbols() {
+    static symbol_table table;
+    return table;
+}
+} // namespace rover
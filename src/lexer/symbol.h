@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace rover {
+// An interned identifier. Equal names have equal symbols, so names can be compared and hashed as
+// integers.
+using symbol = std::uint32_t;
+constexpr symbol no_symbol = UINT32_MAX;
+
+class symbol_table {
+private:
+    // A deque does not move its elements, so the keys of `symbols` stay valid.
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, symbol> symbols;
+
+public:
+    symbol intern(std::string_view name);
+    std::string const& name(symbol s) const { return names[s]; }
+};
+
+// The table all identifiers are interned in.
+symbol_table& symbols();
+} // namespace rover
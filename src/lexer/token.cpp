@@ -19,16 +19,16 @@ std::ostream& operator<<(std::ostream& os, token const& t) {
         os << "CONST";
         break;
     case token_type::IDENTIFIER:
-        os << "IDENTIFIER(" << t.payload.value() << ")";
+        os << "IDENTIFIER(" << symbols().name(t.name) << ")";
         break;
     case token_type::INT:
-        os << "INT(" << t.payload.value() << ")";
+        os << "INT";
         break;
     case token_type::FLOAT:
-        os << "FLOAT(" << t.payload.value() << ")";
+        os << "FLOAT";
         break;
     case token_type::STRING:
-        os << "STRING(" << t.payload.value() << ")";
+        os << "STRING";
         break;
     case token_type::LEFT_BRACE:
         os << "LEFT_BRACE";
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <cstdint>
+#include <initializer_list>
 #include <iostream>
-#include <optional>
-#include <string>
+
+#include "symbol.h"
 
 namespace rover {
-enum class token_type {
+enum class token_type : std::uint8_t {
     IF,
     ELSE,
     WHILE,
@@ -40,12 +42,34 @@ enum class token_type {
     END_OF_FILE
 };
 
+// A set of token types, matched with a single bit test.
+class token_set {
+private:
+    std::uint64_t bits;
+
+    static constexpr std::uint64_t bit(token_type type) { return std::uint64_t{1} << static_cast<unsigned>(type); }
+
+public:
+    constexpr token_set(std::initializer_list<token_type> types) : bits(0) {
+        for (auto type : types) {
+            bits |= bit(type);
+        }
+    }
+
+    constexpr bool contains(token_type type) const { return (bits & bit(type)) != 0; }
+};
+static_assert(static_cast<unsigned>(token_type::END_OF_FILE) < 64, "token_set needs a bit per token type");
+
+// A token refers to its text by its span in the source_buffer it was read from, which also maps
+// its offset to a line and column when those are needed for a diagnostic.
 struct token {
     token_type type;
-    std::size_t line;
-    std::size_t column;
-    std::optional<std::string> payload;
+    std::uint32_t offset;
+    std::uint32_t length;
+    // The interned text of identifiers.
+    symbol name = no_symbol;
 };
+static_assert(sizeof(token) <= 16, "tokens are copied freely and should stay small");
 
 std::ostream& operator<<(std::ostream& os, token const& t);
 } // namespace rover
\ No newline at end of file
@@ -1,29 +1,72 @@
-#include <fstream>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 
+#include "interpreter/compiler.h"
 #include "interpreter/context.h"
+#include "interpreter/flat_interpreter.h"
+#include "interpreter/fusion.h"
 #include "interpreter/interpreter.h"
+#include "interpreter/optimizer.h"
+#include "interpreter/output.h"
+#include "interpreter/resolver.h"
+#include "interpreter/thread_pool.h"
+#include "interpreter/type_checker.h"
+#include "interpreter/vm.h"
 #include "lexer/lexer.h"
+#include "lexer/source.h"
 #include "lexer/token.h"
 #include "parser/ast_printer.h"
+#include "parser/flat_ast.h"
 #include "parser/parser.h"
 
 int main(int argc, char** argv) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <file>" << std::endl;
+    std::string engine = "tree";
+    std::string flush = "line";
+    bool dump_optimized = false;
+    bool fusion = true;
+    char const* threads = nullptr;
+    char const* path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--engine=", 9) == 0) {
+            engine = argv[i] + 9;
+        } else if (std::strncmp(argv[i], "--flush=", 8) == 0) {
+            flush = argv[i] + 8;
+        } else if (std::strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = argv[i] + 10;
+        } else if (std::strcmp(argv[i], "--dump-optimized") == 0) {
+            dump_optimized = true;
+        } else if (std::strcmp(argv[i], "--no-fusion") == 0) {
+            fusion = false;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    bool known_engine = engine == "tree" || engine == "vm" || engine == "flat";
+    bool known_flush = flush == "line" || flush == "full" || flush == "exit";
+    auto thread_count = threads ? std::strtol(threads, nullptr, 10) : 0;
+    bool valid_threads = !threads || thread_count > 0;
+    if (!path || !known_engine || !known_flush || !valid_threads) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--engine=tree|vm|flat] [--flush=line|full|exit] [--threads=N] [--dump-optimized]"
+                     " [--no-fusion] <file>"
+                  << std::endl;
         return 1;
     }
 
-    std::ifstream input(argv[1]);
-    if (!input) {
-        std::cerr << "Could not open file: " << argv[1] << std::endl;
+    auto source = rover::source_buffer::map(path);
+    if (!source) {
+        std::cerr << "Could not open file: " << path << std::endl;
         return 1;
     }
 
-    rover::lexer lexer(input);
+    rover::lexer lexer(std::move(source));
     rover::parser parser(std::move(lexer));
 
-    auto statements = parser.parse();
+    auto program = parser.parse();
     if (!parser.errors().empty()) {
         std::cerr << "There were parser errors:\n";
         for (auto const& error : parser.errors()) {
@@ -32,10 +75,69 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    rover::statement_executor executor(new rover::context(nullptr));
-    for (auto& s : statements) {
+    rover::resolver resolver;
+    auto globals = resolver.resolve(program);
+    if (!resolver.errors().empty()) {
+        std::cerr << "There were resolver errors:\n";
+        for (auto const& error : resolver.errors()) {
+            std::cerr << error << "\n";
+        }
+        return 1;
+    }
+
+    rover::optimizer().optimize(program, globals);
+
+    rover::type_checker checker;
+    checker.check(program, globals);
+    if (!checker.errors().empty()) {
+        std::cerr << "There were type errors:\n";
+        for (auto const& error : checker.errors()) {
+            std::cerr << error << "\n";
+        }
+        return 1;
+    }
+
+    if (fusion) {
+        rover::fuse(program);
+    }
+
+    if (dump_optimized) {
+        rover::statement_printer printer(program);
+        for (auto const& s : program.statements) {
+            s->accept(printer);
+            std::cout << "\n";
+        }
+        return 0;
+    }
+
+    if (flush == "full") {
+        rover::output().set_policy(rover::flush_policy::full);
+    } else if (flush == "exit") {
+        rover::output().set_policy(rover::flush_policy::exit);
+    }
+
+    if (threads) {
+        rover::pool().set_size(static_cast<std::size_t>(thread_count));
+    }
+
+    if (engine == "vm") {
+        rover::vm machine;
+        machine.run(rover::compiler().compile(program, globals));
+        return 0;
+    }
+
+    rover::runtime runtime(program);
+    rover::context root(nullptr, globals);
+    if (engine == "flat") {
+        auto ast = rover::flatten(program);
+        rover::flat_interpreter(ast, runtime, &root).run();
+        return 0;
+    }
+
+    rover::statement_executor executor(runtime, &root);
+    for (auto& s : program.statements) {
         s->accept(executor);
     }
 
     return 0;
-}
\ No newline at end of file
+}
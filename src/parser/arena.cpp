@@ -0,0 +1,55 @@
+#include "arena.h"
+
+#include <algorithm>
+
+namespace rover {
+arena::arena() : next(nullptr), end(nullptr) {}
+
+arena::arena(arena&& other) noexcept
+    : blocks(std::move(other.blocks)), next(other.next), end(other.end), destructors(std::move(other.destructors)) {
+    other.next = other.end = nullptr;
+}
+
+arena& arena::operator=(arena&& other) noexcept {
+    if (this != &other) {
+        release();
+        blocks = std::move(other.blocks);
+        next = other.next;
+        end = other.end;
+        destructors = std::move(other.destructors);
+        other.next = other.end = nullptr;
+    }
+    return *this;
+}
+
+arena::~arena() { release(); }
+
+void arena::release() {
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+    destructors.clear();
+    blocks.clear();
+    next = end = nullptr;
+}
+
+void* arena::allocate(std::size_t size, std::size_t alignment) {
+    auto space = static_cast<std::size_t>(end - next);
+    void* p = next;
+    if (next && std::align(alignment, size, p, space)) {
+        next = static_cast<std::byte*>(p) + size;
+        return p;
+    }
+
+    auto capacity = std::max(block_size, size + alignment);
+    blocks.emplace_back(new std::byte[capacity]);
+    next = blocks.back().get();
+    end = next + capacity;
+
+    space = capacity;
+    p = next;
+    std::align(alignment, size, p, space);
+    next = static_cast<std::byte*>(p) + size;
+    return p;
+}
+} // namespace rover
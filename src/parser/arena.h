@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace rover {
+// A read-only view of a list of nodes allocated in an arena.
+template <typename T>
+class node_list {
+private:
+    T* const* items_;
+    std::size_t size_;
+
+public:
+    node_list() : items_(nullptr), size_(0) {}
+    node_list(T* const* items, std::size_t size) : items_(items), size_(size) {}
+
+    T* const* begin() const { return items_; }
+    T* const* end() const { return items_ + size_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T* front() const { return items_[0]; }
+    T* back() const { return items_[size_ - 1]; }
+    T* operator[](std::size_t i) const { return items_[i]; }
+};
+
+// Bump allocator for syntax tree nodes. Nodes are packed next to each other in
+// large blocks, and are all released at once when the arena is destroyed.
+class arena {
+private:
+    struct destructor {
+        void (*destroy)(void*);
+        void* object;
+    };
+
+    static constexpr std::size_t block_size = 64 * 1024;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte* next;
+    std::byte* end;
+    std::vector<destructor> destructors;
+
+    void* allocate(std::size_t size, std::size_t alignment);
+    void release();
+
+public:
+    arena();
+    arena(arena&& other) noexcept;
+    arena& operator=(arena&& other) noexcept;
+    arena(arena const&) = delete;
+    arena& operator=(arena const&) = delete;
+    ~arena();
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        auto* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destructors.push_back({[](void* p) { static_cast<T*>(p)->~T(); }, object});
+        }
+        return object;
+    }
+
+    template <typename T>
+    node_list<T> list(T* const* items, std::size_t size) {
+        auto* copy = static_cast<T**>(allocate(sizeof(T*) * size, alignof(T*)));
+        std::uninitialized_copy(items, items + size, copy);
+        return {copy, size};
+    }
+
+    template <typename T>
+    node_list<T> list(std::vector<T*> const& items) {
+        return list(items.data(), items.size());
+    }
+};
+} // namespace rover
@@ -1,10 +1,15 @@
 #pragma once
 
-#include <memory>
+#include <cstdint>
+#include <string>
+#include <variant>
 #include <vector>
 
+#include <source.h>
 #include <token.h>
 
+#include "arena.h"
+
 namespace rover {
 class expression;
 struct binary_op_expression;
@@ -14,6 +19,7 @@ struct identifier_expression;
 struct function_call_expression;
 struct array_literal_expression;
 struct array_ref_expression;
+struct cached_expression;
 
 class expression_visitor {
 public:
@@ -25,69 +31,153 @@ public:
     virtual void visit(function_call_expression const& node) = 0;
     virtual void visit(array_literal_expression const& node) = 0;
     virtual void visit(array_ref_expression const& node) = 0;
+    virtual void visit(cached_expression const& node) = 0;
+};
+
+enum class expression_kind : std::uint8_t {
+    binary_op,
+    unary_op,
+    literal,
+    identifier,
+    function_call,
+    array_literal,
+    array_ref,
+    cached,
 };
 
+// What an expression is known to evaluate to before the program runs.
+enum class static_type : std::uint8_t {
+    dynamic, // any value, including the invalid value of a failed operation
+    int_type,
+    double_type,
+    string_type,
+    array_type,
+};
+
+// Nodes are allocated in the program's arena and never deleted through a base pointer.
 class expression {
 public:
-    virtual ~expression() = default;
+    explicit expression(expression_kind kind_) : kind(kind_) {}
     virtual void accept(expression_visitor& visitor) = 0;
+
+    // The concrete type of the node, so that it can be checked without RTTI.
+    expression_kind const kind;
+    // Filled in by the type checker.
+    mutable static_type type = static_type::dynamic;
+
+    // Returns the node as a T, or null if it is a different kind of expression.
+    template <typename T>
+    T const* as() const {
+        return kind == T::node_kind ? static_cast<T const*>(this) : nullptr;
+    }
+
+protected:
+    ~expression() = default;
+};
+
+// Idioms the tree-walking interpreter executes as one operation instead of evaluating their parts.
+enum class fusion : std::uint8_t {
+    none,
+    step,           // x = x + c or x = x - c for a numeric literal c
+    length_compare, // a comparison of a variable with length(a) of another
+    indexed_store,  // a[i] = expression for different variables a and i
 };
 
 struct binary_op_expression : public expression {
-    binary_op_expression(std::unique_ptr<expression> left_, std::unique_ptr<expression> right_, token op_)
-        : left(std::move(left_)), right(std::move(right_)), op(std::move(op_)) {}
+    static constexpr expression_kind node_kind = expression_kind::binary_op;
+    binary_op_expression(expression* left_, expression* right_, token op_)
+        : expression(node_kind), left(left_), right(right_), op(std::move(op_)) {}
     void accept(expression_visitor& visitor) override { visitor.visit(*this); }
 
-    std::unique_ptr<expression> left;
-    std::unique_ptr<expression> right;
+    expression* left;
+    expression* right;
     token op;
+
+    // The specialization of the operator (a quick_op): set by the type checker if the operands' types
+    // are known, and by the tree-walking interpreter for the types it sees.
+    mutable std::uint8_t quickened = 0;
+    // Set by fuse() if the expression is one of the idioms the tree-walking interpreter fuses.
+    mutable fusion fused = fusion::none;
 };
 
 struct unary_op_expression : public expression {
-    unary_op_expression(std::unique_ptr<expression> right_, token op_) : right(std::move(right_)), op(std::move(op_)) {}
+    static constexpr expression_kind node_kind = expression_kind::unary_op;
+    unary_op_expression(expression* right_, token op_) : expression(node_kind), right(right_), op(std::move(op_)) {}
     void accept(expression_visitor& visitor) override { visitor.visit(*this); }
 
-    std::unique_ptr<expression> right;
+    expression* right;
     token op;
+
+    // As in binary_op_expression.
+    mutable std::uint8_t quickened = 0;
 };
 
+// A literal value converted once by the parser and stored in the program's constant pool.
+using constant = std::variant<int, double, std::string>;
+
 struct literal_expression : public expression {
-    literal_expression(token value_) : literal(std::move(value_)) {}
+    static constexpr expression_kind node_kind = expression_kind::literal;
+    literal_expression(token value_, std::size_t constant_)
+        : expression(node_kind), literal(std::move(value_)), constant(constant_) {}
     void accept(expression_visitor& visitor) override { visitor.visit(*this); }
     token literal;
+    std::size_t constant;
 };
 
 struct identifier_expression : public expression {
-    identifier_expression(token identifier_) : identifier(std::move(identifier_)) {}
+    static constexpr expression_kind node_kind = expression_kind::identifier;
+    identifier_expression(token identifier_) : expression(node_kind), identifier(std::move(identifier_)) {}
     void accept(expression_visitor& visitor) override { visitor.visit(*this); }
 
     token identifier;
+
+    // Filled in by the resolver: how many frames up the variable lives, and its slot in that frame.
+    mutable std::size_t depth = 0;
+    mutable std::size_t slot = 0;
 };
 
 struct function_call_expression : public expression {
-    function_call_expression(std::unique_ptr<expression> function_name_,
-                             std::vector<std::unique_ptr<expression>> arguments_)
-        : function_name(std::move(function_name_)), arguments(std::move(arguments_)) {}
+    static constexpr expression_kind node_kind = expression_kind::function_call;
+    function_call_expression(expression* function_name_, token paren_, node_list<expression> arguments_)
+        : expression(node_kind), function_name(function_name_), paren(std::move(paren_)), arguments(arguments_) {}
     void accept(expression_visitor& visitor) override { visitor.visit(*this); }
 
-    std::unique_ptr<expression> function_name;
-    std::vector<std::unique_ptr<expression>> arguments;
+    expression* function_name;
+    token paren;
+    node_list<expression> arguments;
+
+    // Filled in by the resolver: id of the called builtin.
+    mutable std::size_t function = 0;
 };
 
 struct array_literal_expression : public expression {
-    array_literal_expression(std::vector<std::unique_ptr<expression>> elements_) : elements(std::move(elements_)) {}
+    static constexpr expression_kind node_kind = expression_kind::array_literal;
+    array_literal_expression(node_list<expression> elements_) : expression(node_kind), elements(elements_) {}
     void accept(expression_visitor& visitor) override { visitor.visit(*this); }
 
-    std::vector<std::unique_ptr<expression>> elements;
+    node_list<expression> elements;
 };
 
 struct array_ref_expression : public expression {
-    array_ref_expression(std::unique_ptr<expression> array_, std::unique_ptr<expression> index_)
-        : array(std::move(array_)), index(std::move(index_)) {}
+    static constexpr expression_kind node_kind = expression_kind::array_ref;
+    array_ref_expression(expression* array_, expression* index_)
+        : expression(node_kind), array(array_), index(index_) {}
     void accept(expression_visitor& visitor) override { visitor.visit(*this); }
 
-    std::unique_ptr<expression> array;
-    std::unique_ptr<expression> index;
+    expression* array;
+    expression* index;
+};
+
+// Made by the optimizer for a pure expression inside a loop that evaluates to the same value several
+// times: the value is kept in cache `cache` the first time it is computed and reused while the cache
+// is valid, see program::cache_scopes.
+struct cached_expression : public expression {
+    static constexpr expression_kind node_kind = expression_kind::cached;
+    cached_expression(expression* inner_, std::size_t cache_) : expression(node_kind), inner(inner_), cache(cache_) {}
+    void accept(expression_visitor& visitor) override { visitor.visit(*this); }
+
+    expression* inner;
+    std::size_t cache;
 };
 
 struct statement;
@@ -109,51 +199,79 @@ public:
 
 struct statement {
 public:
-    virtual ~statement() = default;
     virtual void accept(statement_visitor& visitor) = 0;
+
+protected:
+    ~statement() = default;
 };
 
 struct expression_statement : public statement {
-    expression_statement(std::unique_ptr<expression> expr_) : expr(std::move(expr_)) {}
+    expression_statement(expression* expr_) : expr(expr_) {}
     void accept(statement_visitor& visitor) override { visitor.visit(*this); }
 
-    std::unique_ptr<expression> expr;
+    expression* expr;
 };
 
 struct block_statement : public statement {
-    block_statement(std::vector<std::unique_ptr<statement>> statements_) : statements(std::move(statements_)) {}
+    block_statement(node_list<statement> statements_) : statements(statements_) {}
     void accept(statement_visitor& visitor) override { visitor.visit(*this); }
 
-    std::vector<std::unique_ptr<statement>> statements;
+    node_list<statement> statements;
+
+    // Filled in by the resolver: number of variables defined directly in this block.
+    mutable std::size_t frame_size = 0;
 };
 
 struct definition_statement : public statement {
-    definition_statement(token identifier_, std::unique_ptr<expression> expr_, bool is_const_)
-        : identifier(std::move(identifier_)), initializer(std::move(expr_)), is_const(is_const_) {}
+    definition_statement(token identifier_, expression* expr_, bool is_const_)
+        : identifier(std::move(identifier_)), initializer(expr_), is_const(is_const_) {}
     void accept(statement_visitor& visitor) override { visitor.visit(*this); }
 
     token identifier;
-    std::unique_ptr<expression> initializer;
+    expression* initializer;
     bool is_const;
+
+    // Filled in by the resolver: slot of the variable in the enclosing frame.
+    mutable std::size_t slot = 0;
 };
 
 struct conditional_statement : public statement {
-    conditional_statement(std::unique_ptr<expression> condition_, std::unique_ptr<statement> then_,
-                          std::unique_ptr<statement> else_)
-        : condition(std::move(condition_)), then_branch(std::move(then_)), else_branch(std::move(else_)) {}
+    conditional_statement(expression* condition_, statement* then_, statement* else_)
+        : condition(condition_), then_branch(then_), else_branch(else_) {}
     void accept(statement_visitor& visitor) override { visitor.visit(*this); }
 
-    std::unique_ptr<expression> condition;
-    std::unique_ptr<statement> then_branch;
-    std::unique_ptr<statement> else_branch;
+    expression* condition;
+    statement* then_branch;
+    statement* else_branch;
 };
 
+constexpr std::size_t no_loop = static_cast<std::size_t>(-1);
+
 struct while_statement : public statement {
-    while_statement(std::unique_ptr<expression> condition_, std::unique_ptr<statement> body_)
-        : condition(std::move(condition_)), body(std::move(body_)) {}
+    while_statement(expression* condition_, statement* body_, std::size_t loop_ = no_loop)
+        : condition(condition_), body(body_), loop(loop_) {}
     void accept(statement_visitor& visitor) override { visitor.visit(*this); }
 
-    std::unique_ptr<expression> condition;
-    std::unique_ptr<statement> body;
+    expression* condition;
+    statement* body;
+    // Set by the optimizer for loops whose caches have to be invalidated as the loop runs.
+    std::size_t loop;
+};
+
+// A cache belongs either to one entry into a loop, for expressions that do not change while the loop
+// runs, or to one iteration of it. It is invalidated when its scope begins again.
+constexpr std::size_t entry_scope(std::size_t loop) { return 2 * loop; }
+constexpr std::size_t iteration_scope(std::size_t loop) { return 2 * loop + 1; }
+
+struct program {
+    // Declared first so that it outlives the tokens referring to it.
+    std::shared_ptr<source_buffer const> source;
+    arena nodes;
+    node_list<statement> statements;
+    std::vector<constant> constants;
+
+    // Filled in by the optimizer: the scope of every cache, and the number of loops owning caches.
+    std::vector<std::size_t> cache_scopes;
+    std::size_t loop_count = 0;
 };
 } // namespace rover
@@ -1,6 +1,11 @@
 #include "ast_printer.h"
 
+#include <charconv>
+#include <string_view>
+
 namespace rover {
+expression_printer::expression_printer(source_buffer const& source_) : source(source_), constants(nullptr) {}
+expression_printer::expression_printer(program const& p) : source(*p.source), constants(&p.constants) {}
 expression_printer::~expression_printer() {}
 
 void expression_printer::visit(binary_op_expression const& node) {
@@ -17,9 +22,30 @@ void expression_printer::visit(unary_op_expression const& node) {
     std::cout << ")";
 }
 
-void expression_printer::visit(literal_expression const& node) { std::cout << *node.literal.payload; }
+void expression_printer::visit(literal_expression const& node) {
+    if (!constants) {
+        std::cout << source.text(node.literal);
+        return;
+    }
+
+    auto const& c = (*constants)[node.constant];
+    if (auto const* d = std::get_if<double>(&c)) {
+        // The shortest text that reads back as the same double, kept a double literal.
+        char buffer[32];
+        auto end = std::to_chars(buffer, buffer + sizeof(buffer), *d).ptr;
+        std::string_view text(buffer, end - buffer);
+        std::cout << text;
+        if (text.find_first_of(".en") == std::string_view::npos) {
+            std::cout << ".0";
+        }
+    } else if (auto const* i = std::get_if<int>(&c)) {
+        std::cout << *i;
+    } else {
+        std::cout << source.text(node.literal);
+    }
+}
 
-void expression_printer::visit(identifier_expression const& node) { std::cout << *node.identifier.payload; }
+void expression_printer::visit(identifier_expression const& node) { std::cout << source.text(node.identifier); }
 
 void expression_printer::visit(function_call_expression const& node) {
     node.function_name->accept(*this);
@@ -41,11 +67,20 @@ void expression_printer::visit(array_literal_expression const& node) {
 }
 
 void expression_printer::visit(array_ref_expression const& node) {
-    std::cout << "[";
     node.array->accept(*this);
+    std::cout << "[";
+    node.index->accept(*this);
     std::cout << "]";
 }
 
+void expression_printer::visit(cached_expression const& node) {
+    std::cout << "#" << node.cache << "(";
+    node.inner->accept(*this);
+    std::cout << ")";
+}
+
+statement_printer::statement_printer(source_buffer const& source_) : source(source_), expr_printer(source_) {}
+statement_printer::statement_printer(program const& p) : source(*p.source), expr_printer(p) {}
 statement_printer::~statement_printer() {}
 
 void statement_printer::visit(expression_statement const& node) {
@@ -68,7 +103,7 @@ void statement_printer::visit(definition_statement const& node) {
     } else {
         std::cout << "var ";
     }
-    std::cout << *node.identifier.payload << " = ";
+    std::cout << source.text(node.identifier) << " = ";
     node.initializer->accept(expr_printer);
     std::cout << ";";
 }
@@ -91,4 +126,100 @@ void statement_printer::visit(while_statement const& node) {
     node.body->accept(*this);
 }
 
-} // namespace rover
\ No newline at end of file
+flat_printer::flat_printer(flat_ast const& ast_) : ast(ast_) {}
+
+void flat_printer::print() {
+    for (node_index i = 0; i < ast.statement_count; ++i) {
+        print_statement(ast.lists[ast.first_statement + i]);
+        std::cout << "\n";
+    }
+}
+
+void flat_printer::print_statement(node_index s) {
+    auto const& t = ast.statements;
+    switch (ast.statement_kinds[s]) {
+    case statement_kind::expression:
+        print_expression(t.a[s]);
+        std::cout << ";";
+        break;
+    case statement_kind::block:
+        std::cout << "{\n";
+        for (node_index i = 0; i < t.b[s]; ++i) {
+            print_statement(ast.lists[t.a[s] + i]);
+            std::cout << "\n";
+        }
+        std::cout << "}";
+        break;
+    case statement_kind::definition:
+        std::cout << (t.c[s] ? "const " : "var ") << ast.source->text(ast.tokens[t.token[s]]) << " = ";
+        print_expression(t.a[s]);
+        std::cout << ";";
+        break;
+    case statement_kind::conditional:
+        std::cout << "if (";
+        print_expression(t.a[s]);
+        std::cout << ") ";
+        print_statement(t.b[s]);
+        if (t.c[s] != no_node) {
+            std::cout << " else ";
+            print_statement(t.c[s]);
+        }
+        break;
+    case statement_kind::while_loop:
+        std::cout << "while (";
+        print_expression(t.a[s]);
+        std::cout << ") ";
+        print_statement(t.b[s]);
+        break;
+    }
+}
+
+void flat_printer::print_expression(node_index e) {
+    auto const& t = ast.expressions;
+    switch (ast.expression_kinds[e]) {
+    case expression_kind::binary_op:
+        std::cout << "(";
+        print_expression(t.a[e]);
+        std::cout << " " << ast.tokens[t.token[e]] << " ";
+        print_expression(t.b[e]);
+        std::cout << ")";
+        break;
+    case expression_kind::unary_op:
+        std::cout << ast.tokens[t.token[e]] << "(";
+        print_expression(t.a[e]);
+        std::cout << ")";
+        break;
+    case expression_kind::literal:
+    case expression_kind::identifier:
+        std::cout << ast.source->text(ast.tokens[t.token[e]]);
+        break;
+    case expression_kind::function_call:
+        std::cout << ast.source->text(ast.tokens[t.token[e]]) << "(";
+        for (node_index i = 0; i < t.b[e]; ++i) {
+            print_expression(ast.lists[t.a[e] + i]);
+            std::cout << ", ";
+        }
+        std::cout << ")";
+        break;
+    case expression_kind::array_literal:
+        std::cout << "[";
+        for (node_index i = 0; i < t.b[e]; ++i) {
+            print_expression(ast.lists[t.a[e] + i]);
+            std::cout << ", ";
+        }
+        std::cout << "]";
+        break;
+    case expression_kind::array_ref:
+        print_expression(t.a[e]);
+        std::cout << "[";
+        print_expression(t.b[e]);
+        std::cout << "]";
+        break;
+    case expression_kind::cached:
+        std::cout << "#" << t.b[e] << "(";
+        print_expression(t.a[e]);
+        std::cout << ")";
+        break;
+    }
+}
+} // namespace rover
@@ -1,10 +1,18 @@
 #pragma once
 
 #include "ast.h"
+#include "flat_ast.h"
 
 namespace rover {
 class expression_printer : public expression_visitor {
+private:
+    source_buffer const& source;
+    std::vector<constant> const* constants;
+
 public:
+    explicit expression_printer(source_buffer const& source_);
+    // Prints literals from the program's constant pool, which also holds the ones made by the optimizer.
+    explicit expression_printer(program const& p);
     virtual ~expression_printer();
     void visit(binary_op_expression const& node) override;
     void visit(unary_op_expression const& node) override;
@@ -13,13 +21,17 @@ public:
     void visit(function_call_expression const& node) override;
     void visit(array_literal_expression const& node) override;
     void visit(array_ref_expression const& node) override;
+    void visit(cached_expression const& node) override;
 };
 
 class statement_printer : public statement_visitor {
 private:
+    source_buffer const& source;
     expression_printer expr_printer;
 
 public:
+    explicit statement_printer(source_buffer const& source_);
+    explicit statement_printer(program const& p);
     virtual ~statement_printer();
     void visit(expression_statement const& node) override;
     void visit(block_statement const& node) override;
@@ -27,4 +39,17 @@ public:
     void visit(conditional_statement const& node) override;
     void visit(while_statement const& node) override;
 };
-} // namespace rover
\ No newline at end of file
+
+// Prints a flat_ast the same way statement_printer prints the tree it was made from.
+class flat_printer {
+private:
+    flat_ast const& ast;
+
+public:
+    explicit flat_printer(flat_ast const& ast_);
+
+    void print();
+    void print_statement(node_index s);
+    void print_expression(node_index e);
+};
+} // namespace rover
@@ -0,0 +1,146 @@
+#include "flat_ast.h"
+
+namespace rover {
+namespace {
+class flattener : public expression_visitor, public statement_visitor {
+private:
+    flat_ast& ast;
+    // Index of the last node added by a visit.
+    node_index last;
+
+    node_index add(flat_ast::table& t, node_index a, node_index b, node_index c, node_index token_) {
+        t.a.push_back(a);
+        t.b.push_back(b);
+        t.c.push_back(c);
+        t.token.push_back(token_);
+        return static_cast<node_index>(t.a.size() - 1);
+    }
+
+    void add(expression const& e, node_index a, node_index b = 0, node_index c = 0, node_index token_ = no_node) {
+        ast.expression_kinds.push_back(e.kind);
+        ast.expression_types.push_back(e.type);
+        last = add(ast.expressions, a, b, c, token_);
+    }
+
+    void add(statement_kind kind, node_index a, node_index b = 0, node_index c = 0, node_index token_ = no_node) {
+        ast.statement_kinds.push_back(kind);
+        last = add(ast.statements, a, b, c, token_);
+    }
+
+    node_index add(token const& t) {
+        ast.tokens.push_back(t);
+        return static_cast<node_index>(ast.tokens.size() - 1);
+    }
+
+    node_index flatten(expression& e) {
+        e.accept(*this);
+        return last;
+    }
+
+    node_index flatten(statement& s) {
+        s.accept(*this);
+        return last;
+    }
+
+    // Flattens the children first, so that the list itself is contiguous.
+    template <typename T>
+    node_index flatten(node_list<T> const& children) {
+        std::vector<node_index> indices;
+        indices.reserve(children.size());
+        for (auto* child : children) {
+            indices.push_back(flatten(*child));
+        }
+
+        auto first = static_cast<node_index>(ast.lists.size());
+        ast.lists.insert(ast.lists.end(), indices.begin(), indices.end());
+        return first;
+    }
+
+public:
+    explicit flattener(flat_ast& ast_) : ast(ast_), last(no_node) {}
+
+    void visit(binary_op_expression const& node) override {
+        auto left = flatten(*node.left);
+        auto right = flatten(*node.right);
+        add(node, left, right, static_cast<node_index>(node.op.type), add(node.op));
+    }
+
+    void visit(unary_op_expression const& node) override {
+        auto right = flatten(*node.right);
+        add(node, right, 0, static_cast<node_index>(node.op.type), add(node.op));
+    }
+
+    void visit(literal_expression const& node) override {
+        add(node, static_cast<node_index>(node.constant), 0, 0, add(node.literal));
+    }
+
+    void visit(identifier_expression const& node) override {
+        add(node, static_cast<node_index>(node.depth), static_cast<node_index>(node.slot), 0,
+            add(node.identifier));
+    }
+
+    void visit(function_call_expression const& node) override {
+        auto callee = node.function_name->as<identifier_expression>();
+        auto first = flatten(node.arguments);
+        add(node, first, static_cast<node_index>(node.arguments.size()),
+            static_cast<node_index>(node.function), callee ? add(callee->identifier) : no_node);
+    }
+
+    void visit(array_literal_expression const& node) override {
+        auto first = flatten(node.elements);
+        add(node, first, static_cast<node_index>(node.elements.size()));
+    }
+
+    void visit(array_ref_expression const& node) override {
+        auto array = flatten(*node.array);
+        auto index = flatten(*node.index);
+        add(node, array, index);
+    }
+
+    void visit(cached_expression const& node) override {
+        auto inner = flatten(*node.inner);
+        add(node, inner, static_cast<node_index>(node.cache));
+    }
+
+    void visit(expression_statement const& node) override { add(statement_kind::expression, flatten(*node.expr)); }
+
+    void visit(block_statement const& node) override {
+        auto first = flatten(node.statements);
+        add(statement_kind::block, first, static_cast<node_index>(node.statements.size()),
+            static_cast<node_index>(node.frame_size));
+    }
+
+    void visit(definition_statement const& node) override {
+        auto initializer = flatten(*node.initializer);
+        add(statement_kind::definition, initializer, static_cast<node_index>(node.slot), node.is_const,
+            add(node.identifier));
+    }
+
+    void visit(conditional_statement const& node) override {
+        auto condition = flatten(*node.condition);
+        auto then_branch = flatten(*node.then_branch);
+        auto else_branch = node.else_branch ? flatten(*node.else_branch) : no_node;
+        add(statement_kind::conditional, condition, then_branch, else_branch);
+    }
+
+    void visit(while_statement const& node) override {
+        auto condition = flatten(*node.condition);
+        auto body = flatten(*node.body);
+        add(statement_kind::while_loop, condition, body,
+            node.loop == no_loop ? no_node : static_cast<node_index>(node.loop));
+    }
+
+    void flatten_program(node_list<statement> const& statements) {
+        ast.first_statement = flatten(statements);
+        ast.statement_count = static_cast<node_index>(statements.size());
+    }
+};
+} // namespace
+
+flat_ast flatten(program const& p) {
+    flat_ast ast;
+    ast.source = p.source;
+    flattener(ast).flatten_program(p.statements);
+    return ast;
+}
+} // namespace rover
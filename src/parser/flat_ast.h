@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <token.h>
+
+#include "ast.h"
+
+namespace rover {
+// Index of a node, a token or the first entry of a child list in a flat_ast.
+using node_index = std::uint32_t;
+constexpr node_index no_node = std::numeric_limits<node_index>::max();
+
+enum class statement_kind : std::uint8_t {
+    expression,
+    block,
+    definition,
+    conditional,
+    while_loop,
+};
+
+// A resolved program stored as tables of plain integers instead of a tree of objects. Every node is
+// a row across the columns of its table and refers to its children by their index. The meaning of
+// the operand columns depends on the kind of the node:
+//
+//   binary_op      a = left, b = right, c = operator token_type
+//   unary_op       a = operand, c = operator token_type
+//   literal        a = constant
+//   identifier     a = depth, b = slot
+//   function_call  a, b = arguments in `lists`, c = builtin id
+//   array_literal  a, b = elements in `lists`
+//   array_ref      a = array, b = index
+//   cached         a = expression, b = cache
+//
+//   expression     a = expression
+//   block          a, b = statements in `lists`, c = frame size
+//   definition     a = initializer, b = slot, c = non-zero for constants
+//   conditional    a = condition, b = then branch, c = else branch or no_node
+//   while_loop     a = condition, b = body, c = loop or no_node
+//
+// Child lists are given as the position of their first entry in `lists` and their length. The token
+// column refers to the node's token in `tokens` (the operator, literal, variable or callee name),
+// which is only needed to print the program.
+struct flat_ast {
+    struct table {
+        std::vector<node_index> a;
+        std::vector<node_index> b;
+        std::vector<node_index> c;
+        std::vector<node_index> token;
+    };
+
+    std::vector<expression_kind> expression_kinds;
+    table expressions;
+    // The type checker's type of every expression, indexed like `expression_kinds`.
+    std::vector<static_type> expression_types;
+    std::vector<statement_kind> statement_kinds;
+    table statements;
+
+    std::vector<node_index> lists;
+    std::vector<token> tokens;
+    // The text the tokens refer to.
+    std::shared_ptr<source_buffer const> source;
+
+    // The top-level statements, in `lists`.
+    node_index first_statement = 0;
+    node_index statement_count = 0;
+};
+
+// Converts a program into a flat_ast. The program must have been resolved.
+flat_ast flatten(program const& p);
+} // namespace rover
@@ -1,5 +1,7 @@
 #include "parser.h"
 
+#include <charconv>
+
 #include <token.h>
 
 #include "ast.h"
@@ -7,152 +9,85 @@
 namespace rover {
 parser::parser(lexer l) : lexer_(l) {}
 
-std::unique_ptr<expression> parser::expression() { return assignment(); }
-
-std::unique_ptr<expression> parser::assignment() {
-    auto e = logic_or();
-    if (!e) {
-        return {};
-    }
-
-    auto t = lexer_.consume_if({token_type::ASSIGN});
-    if (!t) {
-        return e;
-    }
-
-    auto e2 = expression();
-    if (!e2) {
-        return {};
-    }
-
-    return std::make_unique<binary_op_expression>(std::move(e), std::move(e2), *t);
-}
-
-std::unique_ptr<expression> parser::logic_or() {
-    auto left = logic_and();
-    if (!left) {
-        return {};
-    }
-
-    while (auto t = lexer_.consume_if({token_type::OR})) {
-        auto right = logic_and();
-        if (!right) {
-            return {};
-        }
-
-        left = std::make_unique<binary_op_expression>(std::move(left), std::move(right), *t);
-    }
-
-    return left;
-}
-
-std::unique_ptr<expression> parser::logic_and() {
-    auto e = equality();
-    if (!e) {
-        return {};
-    }
-
-    auto t = lexer_.consume_if({token_type::AND});
-    if (!t) {
-        return e;
-    }
-
-    auto e2 = expression();
-    if (!e2) {
-        return {};
-    }
-
-    return std::make_unique<binary_op_expression>(std::move(e), std::move(e2), *t);
-}
-
-std::unique_ptr<expression> parser::equality() {
-    auto left = comparison();
-    if (!left) {
-        return {};
-    }
-
-    while (auto t = lexer_.consume_if({token_type::EQUAL, token_type::NOT_EQUAL})) {
-        auto right = comparison();
-        if (!right) {
-            return {};
-        }
-
-        left = std::make_unique<binary_op_expression>(std::move(left), std::move(right), *t);
+// How strongly an infix operator binds the operands on either side of it, zero for tokens that are not
+// infix operators. An operator continues an expression that is being parsed with a lower minimum
+// power. Left-associative operators parse their right operand with their own power, so that the
+// loop in binary() picks up an equal operator after it; assignment and && take the rest of the
+// expression as their right operand.
+struct binding_power {
+    std::uint8_t left;
+    std::uint8_t right;
+};
+
+static constexpr binding_power infix_power(token_type type) {
+    switch (type) {
+    case token_type::ASSIGN:
+        return {1, 0};
+    case token_type::OR:
+        return {2, 2};
+    case token_type::AND:
+        return {3, 0};
+    case token_type::EQUAL:
+    case token_type::NOT_EQUAL:
+        return {4, 4};
+    case token_type::LESS_THAN:
+    case token_type::LESS_EQUAL:
+    case token_type::GREATER_THAN:
+    case token_type::GREATER_EQUAL:
+        return {5, 5};
+    case token_type::PLUS:
+    case token_type::MINUS:
+        return {6, 6};
+    case token_type::STAR:
+    case token_type::SLASH:
+        return {7, 7};
+    default:
+        return {0, 0};
     }
-
-    return left;
 }
 
-std::unique_ptr<expression> parser::comparison() {
-    auto left = term();
-    if (!left) {
-        return {};
-    }
+expression* parser::expression() { return binary(0); }
 
-    while (auto t = lexer_.consume_if(
-               {token_type::LESS_THAN, token_type::LESS_EQUAL, token_type::GREATER_THAN, token_type::GREATER_EQUAL})) {
-        auto right = term();
-        if (!right) {
-            return {};
-        }
-
-        left = std::make_unique<binary_op_expression>(std::move(left), std::move(right), *t);
-    }
-
-    return left;
-}
-
-std::unique_ptr<expression> parser::term() {
-    auto left = factor();
+expression* parser::binary(std::uint8_t min_power) {
+    auto left = unary();
     if (!left) {
         return {};
     }
 
-    while (auto t = lexer_.consume_if({token_type::PLUS, token_type::MINUS})) {
-        auto right = factor();
-        if (!right) {
-            return {};
+    for (auto t = lexer_.peek(); t; t = lexer_.peek()) {
+        auto power = infix_power(t->type);
+        if (power.left <= min_power) {
+            break;
         }
 
-        left = std::make_unique<binary_op_expression>(std::move(left), std::move(right), *t);
-    }
-
-    return left;
-}
-
-std::unique_ptr<expression> parser::factor() {
-    auto left = unary();
-    if (!left) {
-        return {};
-    }
-
-    while (auto t = lexer_.consume_if({token_type::STAR, token_type::SLASH})) {
-        auto right = unary();
+        auto op = *lexer_.consume();
+        auto right = binary(power.right);
         if (!right) {
             return {};
         }
 
-        left = std::make_unique<binary_op_expression>(std::move(left), std::move(right), *t);
+        left = nodes_.make<binary_op_expression>(left, right, op);
     }
 
     return left;
 }
 
-std::unique_ptr<expression> parser::unary() {
+expression* parser::unary() {
     auto t = lexer_.consume_if({token_type::NOT, token_type::MINUS});
     if (!t) {
         return postfix();
     }
 
+    auto op = *t;
     auto e = postfix();
     if (!e) {
         return {};
     }
 
-    return std::make_unique<unary_op_expression>(std::move(e), *t);
+    return nodes_.make<unary_op_expression>(e, op);
 }
 
-std::unique_ptr<expression> parser::postfix() {
+expression* parser::postfix() {
     auto left = primary();
     if (!left) {
         return {};
@@ -160,14 +95,15 @@ std::unique_ptr<expression> parser::postfix() {
 
     while (auto t = lexer_.consume_if({token_type::LEFT_PAREN, token_type::LEFT_SQUARE})) {
         if (t->type == token_type::LEFT_PAREN) {
-            std::vector<std::unique_ptr<rover::expression>> args;
+            auto paren = *t;
+            auto args = expression_stack_.size();
             do {
                 auto arg = expression();
                 if (!arg) {
                     return {};
                 }
 
-                args.push_back(std::move(arg));
+                expression_stack_.push_back(arg);
             } while (lexer_.consume_if({token_type::COMMA}));
 
             if (!lexer_.consume_if({token_type::RIGHT_PAREN})) {
@@ -175,7 +111,7 @@ std::unique_ptr<expression> parser::postfix() {
                 return {};
             }
 
-            left = std::make_unique<function_call_expression>(std::move(left), std::move(args));
+            left = nodes_.make<function_call_expression>(left, paren, take_list(expression_stack_, args));
         } else if (t->type == token_type::LEFT_SQUARE) {
             auto index = expression();
             if (!index) {
@@ -188,13 +124,50 @@ std::unique_ptr<expression> parser::postfix() {
                 return {};
             }
 
-            left = std::make_unique<array_ref_expression>(std::move(left), std::move(index));
+            left = nodes_.make<array_ref_expression>(left, index);
         }
     }
 
     return left;
 }
-std::unique_ptr<expression> parser::primary() {
+expression* parser::literal(token const& t) {
+    auto text = lexer_.source()->text(t);
+
+    switch (t.type) {
+    case token_type::INT: {
+        int v;
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), v);
+        if (ec == std::errc::result_out_of_range) {
+            report_error("Integer literal out of range", &t);
+            return {};
+        } else if (ec != std::errc() || end != text.data() + text.size()) {
+            report_error("Invalid integer literal", &t);
+            return {};
+        }
+        constants_.push_back(v);
+        break;
+    }
+    case token_type::FLOAT: {
+        double v;
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), v);
+        if (ec == std::errc::result_out_of_range) {
+            report_error("Floating-point literal out of range", &t);
+            return {};
+        } else if (ec != std::errc() || end != text.data() + text.size()) {
+            report_error("Invalid floating-point literal", &t);
+            return {};
+        }
+        constants_.push_back(v);
+        break;
+    }
+    default:
+        constants_.push_back(string_value(text));
+    }
+
+    return nodes_.make<literal_expression>(t, constants_.size() - 1);
+}
+
+expression* parser::primary() {
     auto t = lexer_.consume();
     if (!t) {
         return {};
@@ -202,11 +175,11 @@ std::unique_ptr<expression> parser::primary() {
 
     switch (t->type) {
     case token_type::IDENTIFIER:
-        return std::make_unique<identifier_expression>(*t);
+        return nodes_.make<identifier_expression>(*t);
     case token_type::INT:
     case token_type::FLOAT:
     case token_type::STRING:
-        return std::make_unique<literal_expression>(*t);
+        return literal(*t);
     case token_type::LEFT_PAREN: {
         auto e = expression();
         if (!e) {
@@ -221,7 +194,7 @@ std::unique_ptr<expression> parser::primary() {
         return e;
     }
     case token_type::LEFT_SQUARE: {
-        std::vector<std::unique_ptr<rover::expression>> elements;
+        auto elements = expression_stack_.size();
 
         do {
             auto elem = expression();
@@ -230,7 +203,7 @@ std::unique_ptr<expression> parser::primary() {
                 return {};
             }
 
-            elements.push_back(std::move(elem));
+            expression_stack_.push_back(elem);
         } while (lexer_.consume_if({token_type::COMMA}));
 
         if (!lexer_.consume_if({token_type::RIGHT_SQUARE})) {
@@ -238,7 +211,7 @@ std::unique_ptr<expression> parser::primary() {
             return {};
         }
 
-        return std::make_unique<array_literal_expression>(std::move(elements));
+        return nodes_.make<array_literal_expression>(take_list(expression_stack_, elements));
     }
     default:
         report_error("Expected a primary expression", lexer_.peek());
@@ -246,21 +219,25 @@ std::unique_ptr<expression> parser::primary() {
     }
 }
 
-std::vector<std::unique_ptr<rover::statement>> parser::parse() {
-    std::vector<std::unique_ptr<rover::statement>> statements;
-
+rover::program parser::parse() {
     while (lexer_.peek()->type != token_type::END_OF_FILE) {
         if (auto s = statement()) {
-            statements.push_back(std::move(s));
+            statement_stack_.push_back(s);
         } else {
             return {};
         }
     }
 
-    return statements;
+    // The list is allocated in the arena, so it is taken before the arena is moved.
+    rover::program program;
+    program.statements = take_list(statement_stack_, 0);
+    program.source = lexer_.source();
+    program.nodes = std::move(nodes_);
+    program.constants = std::move(constants_);
+    return program;
 }
 
-std::unique_ptr<rover::statement> parser::statement() {
+rover::statement* parser::statement() {
     auto t = lexer_.peek();
     if (!t) {
         return {};
@@ -281,7 +258,7 @@ std::unique_ptr<rover::statement> parser::statement() {
     }
 }
 
-std::unique_ptr<rover::statement> parser::expression_statement() {
+rover::statement* parser::expression_statement() {
     auto expr = expression();
     if (!expr) {
         return {};
@@ -292,9 +269,9 @@ std::unique_ptr<rover::statement> parser::expression_statement() {
         return {};
     }
 
-    return std::make_unique<rover::expression_statement>(std::move(expr));
+    return nodes_.make<rover::expression_statement>(expr);
 }
-std::unique_ptr<rover::statement> parser::if_statement() {
+rover::statement* parser::if_statement() {
     if (!lexer_.consume_if({token_type::IF})) {
         return {};
     }
@@ -329,8 +306,7 @@ std::unique_ptr<rover::statement> parser::if_statement() {
                 return {};
             }
 
-            return std::make_unique<conditional_statement>(std::move(condition), std::move(then_branch),
-                                                           std::move(else_branch));
+            return nodes_.make<conditional_statement>(condition, then_branch, else_branch);
         } else if (lexer_.peek()->type == token_type::LEFT_BRACE) {
             auto else_branch = block_statement();
             if (!else_branch) {
@@ -338,18 +314,17 @@ std::unique_ptr<rover::statement> parser::if_statement() {
                 return {};
             }
 
-            return std::make_unique<conditional_statement>(std::move(condition), std::move(then_branch),
-                                                           std::move(else_branch));
+            return nodes_.make<conditional_statement>(condition, then_branch, else_branch);
         } else {
             report_error("Expected a block or if statement after else", lexer_.peek());
             return {};
         }
     } else {
-        return std::make_unique<conditional_statement>(std::move(condition), std::move(then_branch), nullptr);
+        return nodes_.make<conditional_statement>(condition, then_branch, nullptr);
     }
 }
 
-std::unique_ptr<rover::statement> parser::while_statement() {
+rover::statement* parser::while_statement() {
     if (!lexer_.consume_if({token_type::WHILE})) {
         return {};
     }
@@ -375,19 +350,18 @@ std::unique_ptr<rover::statement> parser::while_statement() {
         return {};
     }
 
-    return std::make_unique<rover::while_statement>(std::move(condition), std::move(body));
+    return nodes_.make<rover::while_statement>(condition, body);
 }
 
-std::unique_ptr<rover::statement> parser::block_statement() {
+rover::statement* parser::block_statement() {
     if (!lexer_.consume_if({token_type::LEFT_BRACE})) {
         return {};
     }
 
-    std::vector<std::unique_ptr<rover::statement>> statements;
-
+    auto statements = statement_stack_.size();
     while (lexer_.peek()->type != token_type::RIGHT_BRACE) {
         if (auto s = statement()) {
-            statements.push_back(std::move(s));
+            statement_stack_.push_back(s);
         } else {
             return {};
         }
@@ -398,20 +372,22 @@ std::unique_ptr<rover::statement> parser::block_statement() {
         return {};
     }
 
-    return std::make_unique<rover::block_statement>(std::move(statements));
+    return nodes_.make<rover::block_statement>(take_list(statement_stack_, statements));
 }
 
-std::unique_ptr<rover::statement> parser::definition_statement() {
+rover::statement* parser::definition_statement() {
     auto t = lexer_.consume_if({token_type::CONST, token_type::VAR});
     if (!t) {
         return {};
     }
+    auto is_const = t->type == token_type::CONST;
 
     auto name = lexer_.consume_if({token_type::IDENTIFIER});
     if (!name) {
         report_error("Expected an identifier in definition", lexer_.peek());
         return {};
     }
+    auto identifier = *name;
 
     if (!lexer_.consume_if({token_type::ASSIGN})) {
         report_error("Expected an assignment operator after identifier in a definition", lexer_.peek());
@@ -429,6 +405,6 @@ std::unique_ptr<rover::statement> parser::definition_statement() {
         return {};
     }
 
-    return std::make_unique<rover::definition_statement>(*name, std::move(value), t->type == token_type::CONST);
+    return nodes_.make<rover::definition_statement>(identifier, value, is_const);
 }
 } // namespace rover
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <memory>
+#include <cstdint>
 #include <vector>
 
 #include <lexer.h>
@@ -14,29 +14,41 @@ private:
     lexer lexer_;
 
     std::vector<std::string> errors_;
+    std::vector<rover::constant> constants_;
+    arena nodes_;
 
-    std::unique_ptr<rover::expression> expression();
-    std::unique_ptr<rover::expression> assignment();
-    std::unique_ptr<rover::expression> logic_or();
-    std::unique_ptr<rover::expression> logic_and();
-    std::unique_ptr<rover::expression> equality();
-    std::unique_ptr<rover::expression> comparison();
-    std::unique_ptr<rover::expression> term();
-    std::unique_ptr<rover::expression> factor();
-    std::unique_ptr<rover::expression> unary();
-    std::unique_ptr<rover::expression> postfix();
-    std::unique_ptr<rover::expression> primary();
-
-    std::unique_ptr<rover::statement> statement();
-    std::unique_ptr<rover::statement> expression_statement();
-    std::unique_ptr<rover::statement> if_statement();
-    std::unique_ptr<rover::statement> while_statement();
-    std::unique_ptr<rover::statement> block_statement();
-    std::unique_ptr<rover::statement> definition_statement();
-
-    void report_error(std::string const& message, std::optional<token> const& t) {
+    // Lists under construction, shared by all nesting levels: a list is gathered at the top of its
+    // stack and moved into the arena once complete.
+    std::vector<rover::expression*> expression_stack_;
+    std::vector<rover::statement*> statement_stack_;
+
+    template <typename T>
+    node_list<T> take_list(std::vector<T*>& stack, std::size_t start) {
+        auto list = nodes_.list(stack.data() + start, stack.size() - start);
+        stack.resize(start);
+        return list;
+    }
+
+    rover::expression* literal(token const& t);
+
+    rover::expression* expression();
+    // Parses operators that bind more strongly than min_power, see infix_power().
+    rover::expression* binary(std::uint8_t min_power);
+    rover::expression* unary();
+    rover::expression* postfix();
+    rover::expression* primary();
+
+    rover::statement* statement();
+    rover::statement* expression_statement();
+    rover::statement* if_statement();
+    rover::statement* while_statement();
+    rover::statement* block_statement();
+    rover::statement* definition_statement();
+
+    void report_error(std::string const& message, token const* t) {
         if (t) {
-            report_error(message, t->line, t->column);
+            auto position = lexer_.source()->position(*t);
+            report_error(message, position.line, position.column);
         } else {
             report_error(message);
         }
@@ -50,7 +62,7 @@ private:
 
 public:
     parser(lexer l);
-    std::vector<std::unique_ptr<rover::statement>> parse();
+    rover::program parse();
     std::vector<std::string> errors() const { return errors_; }
 };
 } // namespace rover
\ No newline at end of file
@@ -0,0 +1,507 @@
+#include <ast_printer.h>
+#include <builtins.h>
+#include <compiler.h>
+#include <context.h>
+#include <flat_interpreter.h>
+#include <fusion.h>
+#include <gtest/gtest.h>
+#include <interpreter.h>
+#include <kernels.h>
+#include <lexer.h>
+#include <optimizer.h>
+#include <output.h>
+#include <parser.h>
+#include <resolver.h>
+#include <thread_pool.h>
+#include <type_checker.h>
+#include <unistd.h>
+#include <vm.h>
+
+#include <cmath>
+#include <fstream>
+
+class interpreter_test : public ::testing::Test {
+protected:
+    virtual void SetUp() {}
+
+    virtual void TearDown() {}
+
+    std::vector<std::string> resolve(std::string const& source) {
+        std::istringstream input(source);
+        rover::parser parser{rover::lexer(input)};
+        auto program = parser.parse();
+
+        rover::resolver resolver;
+        resolver.resolve(program);
+        return resolver.errors();
+    }
+
+    std::vector<std::string> check(std::string const& source) {
+        std::size_t globals;
+        auto program = load(source, globals);
+
+        rover::type_checker checker;
+        checker.check(program, globals);
+        return checker.errors();
+    }
+
+    // Parses and resolves the source, and optimizes, type checks and fuses it when `optimized` is set.
+    rover::program load(std::string const& source, std::size_t& globals) {
+        std::istringstream input(source);
+        rover::parser parser{rover::lexer(input)};
+        auto program = parser.parse();
+        globals = rover::resolver().resolve(program);
+        if (optimized) {
+            rover::optimizer().optimize(program, globals);
+            rover::type_checker().check(program, globals);
+            rover::fuse(program);
+        }
+        return program;
+    }
+
+    std::string run_tree(std::string const& source) {
+        std::size_t globals;
+        auto program = load(source, globals);
+
+        ::testing::internal::CaptureStdout();
+        rover::context ctx(nullptr, globals);
+        rover::runtime runtime(program);
+        rover::statement_executor executor(runtime, &ctx);
+        for (auto& s : program.statements) {
+            s->accept(executor);
+        }
+        rover::output().flush();
+        return ::testing::internal::GetCapturedStdout();
+    }
+
+    std::string run_flat(std::string const& source) {
+        std::size_t globals;
+        auto program = load(source, globals);
+        auto ast = rover::flatten(program);
+
+        ::testing::internal::CaptureStdout();
+        rover::context ctx(nullptr, globals);
+        rover::runtime runtime(program);
+        rover::flat_interpreter(ast, runtime, &ctx).run();
+        rover::output().flush();
+        return ::testing::internal::GetCapturedStdout();
+    }
+
+    std::string run_vm(std::string const& source) {
+        std::size_t globals;
+        auto program = load(source, globals);
+
+        ::testing::internal::CaptureStdout();
+        rover::vm machine;
+        machine.run(rover::compiler().compile(program, globals));
+        rover::output().flush();
+        return ::testing::internal::GetCapturedStdout();
+    }
+
+    std::string dump_optimized(std::string const& source) {
+        std::size_t globals;
+        optimized = true;
+        auto program = load(source, globals);
+
+        ::testing::internal::CaptureStdout();
+        rover::statement_printer printer(program);
+        for (auto& s : program.statements) {
+            s->accept(printer);
+            std::cout << "\n";
+        }
+        return ::testing::internal::GetCapturedStdout();
+    }
+
+    static std::size_t resident_bytes() {
+        std::ifstream statm("/proc/self/statm");
+        std::size_t size = 0, resident = 0;
+        statm >> size >> resident;
+        return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    // Runs the source on every engine, both as written and optimized.
+    void expect_output(std::string const& source, std::string const& expected) {
+        for (auto optimize : {false, true}) {
+            optimized = optimize;
+            EXPECT_EQ(run_tree(source), expected);
+            EXPECT_EQ(run_vm(source), expected);
+            EXPECT_EQ(run_flat(source), expected);
+        }
+    }
+
+    bool optimized = false;
+};
+
+TEST_F(interpreter_test, test_integer_wrap_around) {
+    expect_output("printf(\"{} {} {} {}\", 2 * 50, 101 - 1, 0 - 99, -10);", "0 0 1 90");
+}
+
+TEST_F(interpreter_test, test_comparison_conversion) {
+    expect_output("if (1.0 == 1.6) { printf(\"yes\"); } else { printf(\"no\"); }", "yes");
+}
+
+TEST_F(interpreter_test, test_scoped_variables) {
+    expect_output("var x = 1; { var x = 2; printf(\"{}\", x); x = 3; } printf(\"{}\", x);", "21");
+}
+
+TEST_F(interpreter_test, test_while_loop) {
+    expect_output("var i = 95; while (i != 0) { printf(\"{} \", i); i = i + 1; }", "95 96 97 98 99 ");
+}
+
+TEST_F(interpreter_test, test_nested_arrays) {
+    expect_output("var b = [[1, 2], [3, 4]]; b[1][0] = 7; push(b[0], 5); printf(\"{} {} {}\", b[1][0], b[0][2], "
+                  "length(b[0])); pop(b); printf(\" {}\", length(b));",
+                  "7 5 3 1");
+}
+
+TEST_F(interpreter_test, test_runtime_errors) {
+    expect_output("printf(\"{}\", 1 + 1.0);",
+                  "Interpreter error: Operator + requires two integers or two doubles.\n"
+                  "INVALID");
+}
+
+TEST_F(interpreter_test, test_undefined_variable) {
+    auto errors = resolve("var x = 1;\n{ var y = x; }\ny = 2;");
+    ASSERT_EQ(errors.size(), 1);
+    EXPECT_EQ(errors.front(), "Variable 'y' is not defined in line 3, column 1");
+}
+
+TEST_F(interpreter_test, test_assignment_to_constant) {
+    auto errors = resolve("const c = 1; var v = 2; v = 3; c = 4;");
+    ASSERT_EQ(errors.size(), 1);
+    EXPECT_EQ(errors.front(), "Cannot assign to constant 'c' in line 1, column 34");
+}
+
+TEST_F(interpreter_test, test_function_errors) {
+    auto errors = resolve("var a = [1];\npush(a);\nprint(a);\nlength(a, 1);");
+    ASSERT_EQ(errors.size(), 3);
+    EXPECT_EQ(errors[0], "Function 'push' requires 2 arguments in line 2, column 5");
+    EXPECT_EQ(errors[1], "Function 'print' is not defined in line 3, column 1");
+    EXPECT_EQ(errors[2], "Function 'length' requires 1 argument in line 4, column 7");
+}
+
+TEST_F(interpreter_test, test_registered_builtin) {
+    // The registry is shared by all tests, so it is given back its own builtins afterwards.
+    auto const original = rover::builtins();
+    rover::builtins().add("sensor", 1, [](rover::value*, rover::value const* args, std::size_t) {
+        return rover::value(args[0].as_int() * 2);
+    });
+    expect_output("var x = sensor(20); printf(\"{}\", x + sensor(1));", "42");
+
+    rover::builtins() = original;
+    EXPECT_EQ(resolve("sensor(1);").size(), 1u);
+}
+
+TEST_F(interpreter_test, test_format_errors) {
+    auto errors = resolve("printf(\"{} {}\", 1);\nprintf(\"\\q\");\nvar f = \"{\"; printf(f);");
+    ASSERT_EQ(errors.size(), 2);
+    EXPECT_EQ(errors[0], "Too few arguments for format string in line 1, column 8");
+    EXPECT_EQ(errors[1], "Unknown escape sequence in format string in line 2, column 8");
+
+    expect_output("var f = \"a{}b{\"; printf(f, 1);", "a1bInterpreter error: Invalid format string\n");
+}
+
+TEST_F(interpreter_test, test_number_formatting) {
+    expect_output("printf(\"{} {} {} {}\\n\", 42, 0.1, 1234567.0, 2.5 / 3.0);", "42 0.1 1.23457e+06 0.833333\n");
+}
+
+TEST_F(interpreter_test, test_arrays_have_value_semantics) {
+    expect_output("var a = [1, [2]]; var b = a; b[0] = 5; b[1][0] = 6; push(b, 7); printf(\"{} {} {}\", a[0], a[1][0], "
+                  "length(a));",
+                  "1 2 2");
+}
+
+TEST_F(interpreter_test, test_arrays_are_evaluated_before_their_index) {
+    expect_output("var a = [5, 1]; printf(\"{}\", a[pop(a)]);\n"
+                  "var b = [[1, 2], [3, 4]]; b[pop(b)[0] - 3][1] = 7; printf(\" {} {}\", length(b), b[0][1]);\n"
+                  "var c = [[1, 2], [3, 4]]; printf(\" {}\", c[0][pop(c)[1] - 3]);",
+                  "1 1 7 2");
+}
+
+TEST_F(interpreter_test, test_targets_are_resolved_after_the_arguments) {
+    expect_output("var b = [[1]]; push(b[0], push(b, [9]));\n"
+                  "printf(\"{} {} {}\\n\", length(b[0]), length(b[0][1]), b[0][1][1][0]);\n"
+                  "var c = [[1, 2], [3]]; push(c[0], c);\n"
+                  "printf(\"{} {} {}\\n\", length(c[0]), length(c[0][2]), c[0][2][0][1]);\n"
+                  "var d = [[1], [2]]; printf(\"{} {}\", push(d[1], pop(d)), length(d));",
+                  "2 2 9\n3 2 2\nInterpreter error: Array index out of bounds.\n"
+                  "Interpreter error: Function push requires an array as its first argument\nINVALID 1");
+}
+
+TEST_F(interpreter_test, test_block_frames_are_released) {
+    // Ten million iterations (comparisons scale the left-hand double by 1.6), each entering a block
+    // with its own variable. Memory must not grow with the number of iterations.
+    auto source = "var n = 0.0; while (n < 16000000.0) { var step = 1.0; n = n + step; } printf(\"done\");";
+    auto before = resident_bytes();
+    EXPECT_EQ(run_tree(source), "done");
+    EXPECT_LT(resident_bytes(), before + (16u << 20));
+}
+
+TEST_F(interpreter_test, test_numeric_arrays_are_compact) {
+    // A million doubles and four million ints, measured while the arrays are still alive: each double
+    // takes 8 bytes and each int a byte.
+    auto before = resident_bytes();
+    std::size_t globals;
+    auto program = load("var a = [0.5]; var b = [0]; var n = 0.0;\n"
+                        "while (n < 1600000.0) { push(a, n); push(b, 1); push(b, 2); push(b, 3); push(b, 4); "
+                        "n = n + 1.0; }",
+                        globals);
+    rover::context ctx(nullptr, globals);
+    rover::runtime runtime(program);
+    rover::statement_executor executor(runtime, &ctx);
+    for (auto& s : program.statements) {
+        s->accept(executor);
+    }
+    EXPECT_EQ(ctx.at(0, 0).as_array().size(), 1000001u);
+    EXPECT_EQ(ctx.at(0, 0).as_array().kind(), rover::array::storage::doubles);
+    EXPECT_EQ(ctx.at(0, 1).as_array().kind(), rover::array::storage::bytes);
+    EXPECT_LT(resident_bytes(), before + (16u << 20));
+}
+
+TEST_F(interpreter_test, test_arrays_change_storage) {
+    expect_output("var a = [1, 2]; push(a, 300); a[0] = 2.5; printf(\"{} {} {} {}\\n\", a[0], a[1], a[2], length(a));\n"
+                  "var d = [1.5, 2.5]; d[1] = 7; push(d, [1]); printf(\"{} {} {}\\n\", d[1], d[2][0], pop(d)[0]);\n"
+                  "var e = [4]; pop(e); push(e, 0.5); push(e, 1.5); e[0] = e[1] + 1.0;\n"
+                  "printf(\"{} {} {}\\n\", e[0], pop(e), length(e));\n"
+                  "var g = [1, 2]; var h = g; h[0] = 9.5; printf(\"{} {}\", g[0], h[0]);",
+                  "2.5 2 300 3\n7 1 1\n2.5 1.5 1\n1 9.5");
+}
+
+TEST_F(interpreter_test, test_whole_array_builtins) {
+    expect_output("var a = [1, 2, 3, 200, 50]; var d = [1.5, 2.5, -3.0]; var g = [1000, 5, 7];\n"
+                  "printf(\"{} {} {} {} {} {} {}\\n\", sum(a), min(a), max(a), dot(a, a), sum(d), min(d), dot(d, d));\n"
+                  "printf(\"{} {} {} {}\\n\", sum(g), min(g), max(g), dot(g, g));\n"
+                  "scale(a, 3); scale(d, 2.0); scale(g, 3);\n"
+                  "printf(\"{} {} {} {}\\n\", a[3], a[4], d[2], g[0] + g[2]);\n"
+                  "fill(g, 2.5); var m = [[1, 2], [3, 4]]; fill(m[1], 9); scale(m[0], 5);\n"
+                  "printf(\"{} {} {} {}\", sum(g), m[0][1], m[1][0], sum(fill(a, 7)));",
+                  "56 1 200 14 1 -3 17.5\n12 5 1000 74\n0 50 -6 21\n7.5 10 9 35");
+    expect_output("printf(\"{}\", sum(5)); printf(\"{}\", min([1, 2.5]));\n"
+                  "var e = [1]; pop(e); printf(\"{}\", max(e));\n"
+                  "printf(\"{}\", dot([1], [1, 2])); printf(\"{}\", dot([1], [1.0]));\n"
+                  "scale(e, 2.0); var f = [1]; scale(f, 2.0);",
+                  "Interpreter error: Function sum requires an array as its argument\nINVALID"
+                  "Interpreter error: Function min requires an array of integers or an array of doubles\nINVALID"
+                  "Interpreter error: Function max requires a non-empty array\nINVALID"
+                  "Interpreter error: Function dot requires arrays of the same length\nINVALID"
+                  "Interpreter error: Function dot requires two arrays of integers or two arrays of doubles\nINVALID"
+                  "Interpreter error: Function scale requires a factor of the same type as the elements of the "
+                  "array\n");
+}
+
+TEST_F(interpreter_test, test_kernels_agree_on_every_instruction_set) {
+    // Lengths that leave a partial vector, and enough bytes for the dot product to flush its sums.
+    std::vector<double> doubles(1027);
+    for (std::size_t i = 0; i < doubles.size(); ++i) {
+        doubles[i] = std::sin(static_cast<double>(i)) * std::pow(10.0, static_cast<double>(i % 7));
+    }
+    std::vector<std::uint8_t> bytes(300007);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<std::uint8_t>(i * 7919 % 251 + 3);
+    }
+
+    auto results = [&] {
+        auto scaled = doubles;
+        rover::kernels::scale(scaled.data(), scaled.size(), 0.3);
+        return std::make_tuple(rover::kernels::sum(doubles.data(), doubles.size()),
+                               rover::kernels::dot(doubles.data(), scaled.data(), doubles.size()),
+                               rover::kernels::min(doubles.data(), doubles.size()),
+                               rover::kernels::max(doubles.data(), doubles.size()), scaled,
+                               rover::kernels::sum(bytes.data(), bytes.size()),
+                               rover::kernels::dot(bytes.data(), bytes.data(), bytes.size()),
+                               rover::kernels::min(bytes.data(), bytes.size()),
+                               rover::kernels::max(bytes.data(), bytes.size()));
+    };
+
+    auto widest = rover::kernels::detect();
+    rover::kernels::use(rover::kernels::instruction_set::scalar);
+    auto expected = results();
+    EXPECT_EQ(std::get<6>(expected), 6490408158u);
+    for (auto set : {rover::kernels::instruction_set::sse2, rover::kernels::instruction_set::avx2}) {
+        if (set <= widest) {
+            rover::kernels::use(set);
+            EXPECT_EQ(results(), expected);
+        }
+    }
+    rover::kernels::use(widest);
+}
+
+TEST_F(interpreter_test, test_parallel_builtins) {
+    expect_output("var d = [2.5, -1.0, 4.0]; var b = [9, 3, 250]; var g = [7.5, 1, 300]; g[1] = 0.5; pop(g);\n"
+                  "parallel_sort(d); parallel_sort(b); parallel_sort(g); parallel_apply(d, \"clamp\", 0.0, 3.0);\n"
+                  "parallel_apply(b, \"offset\", 95); parallel_apply(g, \"scale\", 2.0);\n"
+                  "printf(\"{} {} {} {} {} {}\", d[0], d[2], parallel_sum(d), b[2], parallel_sum(b), g[1]);\n"
+                  "parallel_apply(b, \"clamp\", 1); parallel_apply(d, \"offset\", 1); parallel_apply(b, \"shift\", 1);",
+                  "0 3 5.5 45 47 15"
+                  "Interpreter error: Function parallel_apply requires two operands for clamp\n"
+                  "Interpreter error: Function parallel_apply requires operands of the same type as the elements of "
+                  "the array\n"
+                  "Interpreter error: Function parallel_apply requires \"scale\", \"offset\" or \"clamp\" as its "
+                  "second argument\n");
+}
+
+TEST_F(interpreter_test, test_parallel_builtins_do_not_depend_on_thread_count) {
+    // Doubles of many magnitudes over several chunks, whose sum depends on the order of additions.
+    std::vector<rover::value> elements;
+    for (int i = 0; i < 300000; ++i) {
+        elements.emplace_back(std::sin(i) * std::pow(10.0, i % 13));
+    }
+    rover::value const doubles(elements);
+
+    auto results = [&](std::size_t threads) {
+        rover::pool().set_size(threads);
+        auto sorted = doubles;
+        rover::builtin_parallel_sort(&sorted);
+        rover::value operands[] = {rover::value(std::string("offset")), rover::value(0.1)};
+        auto offset = doubles;
+        rover::builtin_parallel_apply(&offset, operands, 2);
+        return std::make_tuple(rover::builtin_parallel_sum(doubles).as_double(), sorted.as_array().doubles(),
+                               offset.as_array().doubles());
+    };
+
+    auto expected = results(1);
+    EXPECT_TRUE(std::is_sorted(std::get<1>(expected).begin(), std::get<1>(expected).end()));
+    for (std::size_t threads : {2, 3, 8}) {
+        EXPECT_EQ(results(threads), expected);
+    }
+    rover::pool().set_size(std::thread::hardware_concurrency());
+}
+
+TEST_F(interpreter_test, test_thread_pool_can_be_resized) {
+    for (std::size_t threads : {3, 1, 4, 2, 4}) {
+        rover::pool().set_size(threads);
+        EXPECT_EQ(rover::pool().size(), threads);
+        for (std::size_t batch = 1; batch <= 3; ++batch) {
+            std::vector<std::size_t> runs(100);
+            rover::pool().run(runs.size(), [&](std::size_t task) { runs[task] += batch; });
+            EXPECT_EQ(runs, std::vector<std::size_t>(100, batch));
+        }
+    }
+    rover::pool().set_size(std::thread::hardware_concurrency());
+}
+
+TEST_F(interpreter_test, test_constant_folding) {
+    EXPECT_EQ(dump_optimized("const c = 4; printf(\"{}\", c * 30 - 1, 2.5 / 2.0, 1 + 1.0);\n"
+                             "if (c < 5) { printf(\"a\"); } else { printf(\"b\"); }\n"
+                             "while (0) { printf(\"never\"); } var v = 1 / 0; push(c, -c); var z = 1.0 == 1.6;"),
+              "const c = 4;\n"
+              "printf(\"{}\", 19, 1.25, (1 PLUS 1.0), );\n"
+              "{\nprintf(\"a\", );\n}\n"
+              "var v = (1 SLASH 0);\n"
+              "push(c, 96, );\n"
+              "var z = 1;\n");
+}
+
+TEST_F(interpreter_test, test_constant_propagation_follows_scopes) {
+    expect_output("const c = 2; var x = 0; { const c = 3.0; printf(\"{} \", c); var c = 5; c = c + 1; x = c; }\n"
+                  "while (x < c * 5) { x = x + c; } printf(\"{} {}\", c, x);",
+                  "3 2 10");
+}
+
+TEST_F(interpreter_test, test_loop_caches) {
+    EXPECT_EQ(dump_optimized("var a = [1, 2]; var i = 0;\n"
+                             "while (i < length(a)) {\n"
+                             "    printf(\"{}\", a[i] * a[i]); a[i] = 0; printf(\"{}\", a[i]); i = i + 1;\n"
+                             "}"),
+              "var a = [1, 2, ];\n"
+              "var i = 0;\n"
+              "while ((i LESS_THAN length(a, ))) {\n"
+              "printf(\"{}\", (#0(a[i]) STAR #0(a[i])), );\n"
+              "(a[i] ASSIGN 0);\n"
+              "printf(\"{}\", #1(a[i]), );\n"
+              "(i ASSIGN (i PLUS 1));\n"
+              "}\n");
+    EXPECT_EQ(dump_optimized("var a = [1, 2]; var n = 3; var i = 0; while (i < length(a) * n) { i = i + 1; }"),
+              "var a = [1, 2, ];\n"
+              "var n = 3;\n"
+              "var i = 0;\n"
+              "while ((i LESS_THAN #0((length(a, ) STAR n)))) {\n"
+              "(i ASSIGN (i PLUS 1));\n"
+              "}\n");
+}
+
+TEST_F(interpreter_test, test_loop_caches_are_invalidated) {
+    // Writes to the variables a cached expression reads, new iterations and new entries into a loop
+    // must all recompute it, and expressions failing with an error have to fail every time.
+    expect_output("var a = [1, 2, 3]; var n = 0;\n"
+                  "while (n < 2) {\n"
+                  "    var i = 0;\n"
+                  "    while (i < length(a)) {\n"
+                  "        printf(\"{} \", a[i] + a[i] * length(a));\n"
+                  "        if (a[i] == 2) { push(a, 9); }\n"
+                  "        printf(\"{} \", length(a) + a[i]);\n"
+                  "        a[i] = a[i] + 1;\n"
+                  "        printf(\"{};\", a[i] + a[i]);\n"
+                  "        i = i + 1;\n"
+                  "    }\n"
+                  "    printf(\"{} {}|\", a[7] + a[7], length(a) + 1.0 + length(a));\n"
+                  "    n = n + 1;\n"
+                  "}",
+                  "4 4 4;8 6 6;15 7 8;45 13 20;"
+                  "Interpreter error: Array index out of bounds\n"
+                  "Interpreter error: Array index out of bounds\n"
+                  "Interpreter error: Operator + requires two integers or two doubles.\n"
+                  "Interpreter error: Operator + requires two integers or two doubles.\n"
+                  "Interpreter error: Operator + requires two integers or two doubles.\n"
+                  "INVALID INVALID|10 7 6;18 8 8;24 9 10;60 15 22;54 14 20;"
+                  "Interpreter error: Array index out of bounds\n"
+                  "Interpreter error: Array index out of bounds\n"
+                  "Interpreter error: Operator + requires two integers or two doubles.\n"
+                  "Interpreter error: Operator + requires two integers or two doubles.\n"
+                  "Interpreter error: Operator + requires two integers or two doubles.\n"
+                  "INVALID INVALID|");
+}
+
+TEST_F(interpreter_test, test_quickened_operators_follow_operand_types) {
+    // Every operator is specialized for the types it sees first, and has to notice when they change.
+    expect_output("var a = [1, 2.5, 3, \"x\", 4.0, 7]; var i = 0;\n"
+                  "while (i < 6) { printf(\"{} {} {} {};\", a[i] + a[i], -a[i], a[i] < a[i], !a[i]); i = i + 1; }",
+                  "2 99 0 0;5 -2.5 0 0;6 97 0 0;"
+                  "Interpreter error: Operator + requires two integers or two doubles.\n"
+                  "Interpreter error: Unary operator '-' requires an integer or double.\n"
+                  "Interpreter error: Operator < requires two integers or two doubles.\n"
+                  "Interpreter error: Unary operator '!' requires an integer or double.\n"
+                  "INVALID INVALID INVALID INVALID;8 -4 0 0;14 93 0 0;");
+}
+
+TEST_F(interpreter_test, test_type_errors) {
+    EXPECT_EQ(check("var i = 1; var d = 2.5; printf(\"{} {}\", i + d, -\"s\");\n"
+                    "var a = [1]; var b = a < 2; var c = !a + (i * 2 == 4) + (d / 2.0 <= 1.0);"),
+              (std::vector<std::string>{
+                  "Operator + requires two integers or two doubles, but is applied to an integer and a double "
+                  "in line 1, column 43",
+                  "Unary operator '-' requires an integer or double, but is applied to a string in line 1, column 48",
+                  "Operator < requires two integers or two doubles, but is applied to an array and an integer "
+                  "in line 2, column 24",
+                  "Unary operator '!' requires an integer or double, but is applied to an array in line 2, column 37",
+              }));
+
+    // Variables holding values of different types, array elements and the results of failed operations
+    // can be anything. The type of a variable depends on all assignments to it, including later ones.
+    EXPECT_EQ(check("var x = 1; x = 2.5; var a = [1, 2.5]; printf(\"{}\", x + 1, a[0] + 1.0, (1 + 1.0) + 1);\n"
+                    "var n = 1; var m = n; while (m < 3) { m = m + n; n = 0.5; }"),
+              (std::vector<std::string>{
+                  "Operator + requires two integers or two doubles, but is applied to an integer and a double "
+                  "in line 1, column 74",
+              }));
+}
+
+TEST_F(interpreter_test, test_fused_idioms) {
+    // Fused idioms fall back to evaluating their parts for values they do not apply to, and report
+    // the same errors.
+    expect_output("var a = [1, 2, 3]; var i = 0; var d = 0.5;\n"
+                  "while (i < length(a)) { a[i] = a[i] * 40; i = i + 1; d = d - 0.25; }\n"
+                  "printf(\"{} {} {} {} {}\\n\", a[0], a[1], a[2], i = i - 5, d);\n"
+                  "var s = \"x\"; s = s + 1; i = i + 1.5; var j = 7; a[j] = 1; j = 99; j = j + 3;\n"
+                  "printf(\"{} {}\\n\", j < length(s), j < length(a));\n"
+                  "var k = 0; while (k < length(a)) { push(a, k); k = k + 40; } printf(\"{} {}\", k, length(a));",
+                  "40 80 20 98 -0.25\n"
+                  "Interpreter error: Operator + requires two integers or two doubles.\n"
+                  "Interpreter error: Operator + requires two integers or two doubles.\n"
+                  "Interpreter error: Array index out of bounds.\n"
+                  "Interpreter error: Variable not found.\n"
+                  "Interpreter error: Function length requires an array as its argument\n"
+                  "Interpreter error: Operator < requires two integers or two doubles.\n"
+                  "INVALID 1\n"
+                  "40 4");
+}
@@ -16,7 +16,7 @@ TEST_F(lexer_test, test_lexer_peek) {
     auto token = lexer.peek();
     ASSERT_TRUE(token);
     EXPECT_EQ(token->type, rover::token_type::PLUS);
-    EXPECT_FALSE(token->payload);
+    EXPECT_EQ(token->length, 1);
 }
 
 TEST_F(lexer_test, test_lexer_consume) {
@@ -26,12 +26,12 @@ TEST_F(lexer_test, test_lexer_consume) {
     auto token = lexer.consume();
     ASSERT_TRUE(token);
     EXPECT_EQ(token->type, rover::token_type::PLUS);
-    EXPECT_FALSE(token->payload);
+    EXPECT_EQ(token->length, 1);
 
     token = lexer.peek();
     ASSERT_TRUE(token);
     EXPECT_EQ(token->type, rover::token_type::END_OF_FILE);
-    EXPECT_FALSE(token->payload);
+    EXPECT_EQ(token->length, 0);
 }
 
 TEST_F(lexer_test, test_lexer_consume_if) {
@@ -41,12 +41,12 @@ TEST_F(lexer_test, test_lexer_consume_if) {
     auto token = lexer.consume_if({rover::token_type::PLUS});
     ASSERT_TRUE(token);
     EXPECT_EQ(token->type, rover::token_type::PLUS);
-    EXPECT_FALSE(token->payload);
+    EXPECT_EQ(token->length, 1);
 
     token = lexer.peek();
     ASSERT_TRUE(token);
     EXPECT_EQ(token->type, rover::token_type::END_OF_FILE);
-    EXPECT_FALSE(token->payload);
+    EXPECT_EQ(token->length, 0);
 }
 
 TEST_F(lexer_test, test_lexer_consume_if_not) {
@@ -59,5 +59,62 @@ TEST_F(lexer_test, test_lexer_consume_if_not) {
     token = lexer.peek();
     ASSERT_TRUE(token);
     EXPECT_EQ(token->type, rover::token_type::PLUS);
-    EXPECT_FALSE(token->payload);
+    EXPECT_EQ(token->length, 1);
+}
+
+TEST_F(lexer_test, test_lexer_token_set) {
+    constexpr rover::token_set comparisons{rover::token_type::LESS_THAN, rover::token_type::GREATER_EQUAL};
+    static_assert(comparisons.contains(rover::token_type::LESS_THAN));
+    static_assert(!comparisons.contains(rover::token_type::LESS_EQUAL));
+
+    rover::lexer lexer(std::string_view(">= <"));
+    EXPECT_FALSE(lexer.consume_if({rover::token_type::LESS_THAN}));
+    EXPECT_TRUE(lexer.consume_if(comparisons));
+    EXPECT_TRUE(lexer.consume_if(comparisons));
+    EXPECT_EQ(lexer.peek()->type, rover::token_type::END_OF_FILE);
+}
+
+TEST_F(lexer_test, test_lexer_tokens_are_spans_of_the_source) {
+    auto source = rover::source_buffer::borrow("name\n12.5 \"a\\\"b\"");
+    rover::lexer lexer(source);
+
+    auto token = lexer.consume();
+    ASSERT_TRUE(token);
+    EXPECT_EQ(token->type, rover::token_type::IDENTIFIER);
+    EXPECT_EQ(source->text(*token), "name");
+
+    token = lexer.consume();
+    ASSERT_TRUE(token);
+    EXPECT_EQ(token->type, rover::token_type::FLOAT);
+    EXPECT_EQ(source->text(*token), "12.5");
+    EXPECT_EQ(source->position(*token).line, 2);
+    EXPECT_EQ(source->position(*token).column, 1);
+
+    token = lexer.consume();
+    ASSERT_TRUE(token);
+    EXPECT_EQ(token->type, rover::token_type::STRING);
+    EXPECT_EQ(source->text(*token), "\"a\\\"b\"");
+    EXPECT_EQ(rover::string_value(source->text(*token)), "a\"b");
+    EXPECT_EQ(source->position(*token).column, 6);
+
+    token = lexer.peek();
+    ASSERT_TRUE(token);
+    EXPECT_EQ(token->type, rover::token_type::END_OF_FILE);
+    EXPECT_EQ(sizeof(*token), 16);
+}
+
+TEST_F(lexer_test, test_lexer_interns_identifiers) {
+    rover::lexer lexer(std::string_view("count total count"));
+
+    // A consumed token is only valid until the next consume, so keep copies.
+    rover::token tokens[3];
+    for (auto& t : tokens) {
+        auto const* token = lexer.consume();
+        ASSERT_TRUE(token);
+        t = *token;
+    }
+    EXPECT_NE(tokens[0].name, rover::no_symbol);
+    EXPECT_NE(tokens[0].name, tokens[1].name);
+    EXPECT_EQ(tokens[0].name, tokens[2].name);
+    EXPECT_EQ(rover::symbols().name(tokens[0].name), "count");
 }
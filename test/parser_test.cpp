@@ -0,0 +1,118 @@
+#include <ast_printer.h>
+#include <flat_ast.h>
+#include <gtest/gtest.h>
+#include <lexer.h>
+#include <parser.h>
+
+class parser_test : public ::testing::Test {
+protected:
+    virtual void SetUp() {}
+
+    virtual void TearDown() {}
+};
+
+TEST_F(parser_test, test_literals_are_pooled) {
+    std::istringstream input("printf(\"{} {}\", 42, 1.5);");
+    rover::parser parser{rover::lexer(input)};
+
+    auto program = parser.parse();
+    ASSERT_TRUE(parser.errors().empty());
+    ASSERT_EQ(program.constants.size(), 3);
+    EXPECT_EQ(std::get<std::string>(program.constants[0]), "{} {}");
+    EXPECT_EQ(std::get<int>(program.constants[1]), 42);
+    EXPECT_EQ(std::get<double>(program.constants[2]), 1.5);
+}
+
+TEST_F(parser_test, test_integer_literal_out_of_range) {
+    std::istringstream input("var x = 99999999999;");
+    rover::parser parser{rover::lexer(input)};
+
+    parser.parse();
+    ASSERT_FALSE(parser.errors().empty());
+    EXPECT_EQ(parser.errors().front(), "Integer literal out of range in line 1, column 9");
+}
+
+TEST_F(parser_test, test_expression_kinds) {
+    std::istringstream input("board[i][j] = 1;");
+    rover::parser parser{rover::lexer(input)};
+
+    auto program = parser.parse();
+    ASSERT_TRUE(parser.errors().empty());
+    auto statement = static_cast<rover::expression_statement const*>(program.statements.front());
+    auto assignment = statement->expr->as<rover::binary_op_expression>();
+    ASSERT_NE(assignment, nullptr);
+    EXPECT_EQ(assignment->right->kind, rover::expression_kind::literal);
+
+    auto outer = assignment->left->as<rover::array_ref_expression>();
+    ASSERT_NE(outer, nullptr);
+    EXPECT_EQ(outer->index->as<rover::literal_expression>(), nullptr);
+    auto inner = outer->array->as<rover::array_ref_expression>();
+    ASSERT_NE(inner, nullptr);
+    EXPECT_NE(inner->array->as<rover::identifier_expression>(), nullptr);
+}
+
+TEST_F(parser_test, test_flat_ast_prints_like_tree) {
+    std::istringstream input("var a = [1, 2.5, \"x\"]; var c = -a[0];\n"
+                             "while (c < 3) { a[1] = length(a) + c * 2;\n"
+                             "if (!c) { push(a, 1); } else { const d = 1; } }");
+    rover::parser parser{rover::lexer(input)};
+    auto program = parser.parse();
+    ASSERT_TRUE(parser.errors().empty());
+
+    ::testing::internal::CaptureStdout();
+    rover::statement_printer printer(*program.source);
+    for (auto* s : program.statements) {
+        s->accept(printer);
+        std::cout << "\n";
+    }
+    auto tree = ::testing::internal::GetCapturedStdout();
+
+    auto ast = rover::flatten(program);
+    EXPECT_EQ(ast.statement_count, 3);
+    ::testing::internal::CaptureStdout();
+    rover::flat_printer(ast).print();
+    EXPECT_EQ(::testing::internal::GetCapturedStdout(), tree);
+}
+
+TEST_F(parser_test, test_operator_precedence) {
+    // The tree for each expression, as the recursive descent parser built it.
+    std::pair<char const*, char const*> cases[] = {
+        {"1 + 2 * 3 - 4 / 5;", "((1 PLUS (2 STAR 3)) MINUS (4 SLASH 5));"},
+        {"a = b = c + 1;", "(a ASSIGN (b ASSIGN (c PLUS 1)));"},
+        {"a + b = c;", "((a PLUS b) ASSIGN c);"},
+        {"a < b == c >= d != e;", "(((a LESS_THAN b) EQUAL (c GREATER_EQUAL d)) NOT_EQUAL e);"},
+        {"-a * !b[0] - f(1, g(2))[3];", "((MINUS(a) STAR NOT(b[0])) MINUS f(1, g(2, ), )[3]);"},
+        {"x = [1, -2, (3 + 4) * 5];", "(x ASSIGN [1, MINUS(2), ((3 PLUS 4) STAR 5), ]);"},
+    };
+
+    for (auto const& [source, expected] : cases) {
+        std::istringstream input(source);
+        rover::parser parser{rover::lexer(input)};
+        auto program = parser.parse();
+        ASSERT_TRUE(parser.errors().empty()) << source;
+
+        ::testing::internal::CaptureStdout();
+        rover::statement_printer printer(*program.source);
+        program.statements.front()->accept(printer);
+        EXPECT_EQ(::testing::internal::GetCapturedStdout(), expected) << source;
+    }
+}
+
+TEST_F(parser_test, test_expression_errors) {
+    std::pair<char const*, char const*> cases[] = {
+        {"1 + ;", "Expected a primary expression in line 1, column 6"},
+        {"f(1;", "Expected ')' after function arguments in line 1, column 4"},
+        {"a[1;", "Expected ']' after function arguments in line 1, column 4"},
+        {"(1 + 2;", "Expected ')' at the end of expression in line 1, column 7"},
+        {"- - a;", "Expected a primary expression in line 1, column 5"},
+        {"x = 1 * (2 +);", "Expected a primary expression in line 1, column 14"},
+    };
+
+    for (auto const& [source, expected] : cases) {
+        std::istringstream input(source);
+        rover::parser parser{rover::lexer(input)};
+        parser.parse();
+        ASSERT_EQ(parser.errors().size(), 1) << source;
+        EXPECT_EQ(parser.errors().front(), expected) << source;
+    }
+}